@@ -0,0 +1,28 @@
+// thin lens camera
+#ifndef CAMERA_GLSL
+#define CAMERA_GLSL
+#include "functions.glsl"
+#include "sampler.glsl"
+#include "ray.glsl"
+struct Camera {
+  vec3 lower_left_corner;
+  vec3 origin;
+  vec3 vertical;
+  vec3 horizontal;
+  vec3 u;
+  vec3 v;
+  vec3 w;
+  float lens_radius;
+  float time0; // shutter open time
+  float time1; // shutter close time
+};
+Ray get_ray(Camera ca, float u, float v, inout Sampler smp) {
+  // get camera ray
+  vec3 rd = ca.lens_radius * random_in_unit_disk(smp);
+  vec3 offst = ca.u * rd.x + ca.v * rd.y;
+  vec3 r_origin = ca.origin + offst;
+  vec3 r_dir =
+      ca.lower_left_corner + (u * ca.horizontal) + (v * ca.vertical) - r_origin;
+  return makeRay(r_origin, r_dir);
+}
+#endif
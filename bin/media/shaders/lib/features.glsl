@@ -0,0 +1,68 @@
+// per pixel outputs of the megakernels besides the color: the squared
+// luminances of adaptive sampling (ADAPTIVE) and the first hit features of
+// the denoiser (DENOISE). Without the define the store does nothing. The
+// kernel declares img_output before the include.
+#ifndef FEATURES_GLSL
+#define FEATURES_GLSL
+#include "functions.glsl"
+#include "ray.glsl"
+#include "params.glsl"
+#include "hittable.glsl"
+#include "material.glsl"
+#ifdef ADAPTIVE
+layout(rgba32f, binding = 3) uniform image2D img_moments;
+// x: running sum of the squared sample luminances
+#endif
+#ifdef DENOISE
+// first hit features of the denoiser, written when the accumulation restarts
+layout(rgba32f, binding = 4) writeonly uniform image2D img_albedo;
+layout(rgba32f, binding = 5) writeonly uniform image2D img_normal;
+// xyz: normal, w: hit distance
+const float DENOISE_FAR = 1e6; // hit distance stored for the sky
+vec3 material_albedo(in Material mat, in HitRecord record) {
+  // surface color before any scattering, the denoiser filters the light
+  // arriving at the surface and multiplies this back
+  if (mat.type == 0) {
+    return lambertColor(mat.lam, record);
+  } else if (mat.type == 1) {
+    return mat.met.albedo;
+  }
+  return vec3(1);
+}
+#endif
+
+void store_moments(ivec2 pixel_index, float rsquared) {
+  // squared samples for the variance of the tile pass
+#ifdef ADAPTIVE
+  vec4 moments = vec4(rsquared, 0, 0, 0);
+  if (frame_index > 0) {
+    moments += imageLoad(img_moments, pixel_index);
+  }
+  imageStore(img_moments, pixel_index, moments);
+#endif
+}
+
+void store_features(in Camera cam, ivec2 pixel_index) {
+  // pinhole ray through the pixel center, without lens or jitter samples.
+  // The features stay put while the samples accumulate.
+#ifdef DENOISE
+  if (frame_index != 0 || preview_step != 1) {
+    return;
+  }
+  ivec2 img_dims = imageSize(img_output);
+  float u = (pixel_index.x + 0.5) / (img_dims.x - 1);
+  float v = (pixel_index.y + 0.5) / (img_dims.y - 1);
+  Ray r = makeRay(cam.origin, cam.lower_left_corner + u * cam.horizontal +
+                                  v * cam.vertical - cam.origin);
+  HitRecord rec;
+  vec3 albedo = vec3(1);
+  vec4 normal = vec4(-normalize(r.direction), DENOISE_FAR);
+  if (hit_scene(r, 0.001, INFINITY, rec)) {
+    albedo = material_albedo(getMaterial(rec.obj_index), rec);
+    normal = vec4(rec.normal, distance(r.origin, rec.point));
+  }
+  imageStore(img_albedo, pixel_index, vec4(albedo, 1));
+  imageStore(img_normal, pixel_index, normal);
+#endif
+}
+#endif
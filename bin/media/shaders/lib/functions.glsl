@@ -0,0 +1,51 @@
+// constants, pcg random numbers and vector helpers
+#ifndef FUNCTIONS_GLSL
+#define FUNCTIONS_GLSL
+float PI = 3.1415926535;
+float INFINITY = 1.0 / 0.0;
+float degree_to_radian(float degree) {
+  //
+  return degree * PI / 180.0;
+}
+uint pcg_hash(uint v) {
+  // stateless pcg permutation, used to mix the seed inputs
+  uint state = v * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+uint pcg_next(inout uint state) {
+  // pcg step: advance the lcg state, permute it for output
+  state = state * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+float random_double(inout uint seed) {
+  // random double in [0, 1)
+  return float(pcg_next(seed) >> 8) / 16777216.0;
+}
+float random_double(float mi, float mx, inout uint seed) {
+  // random double in [mi, mx)
+  return mi + (mx - mi) * random_double(seed);
+}
+int random_int(int mi, int mx, inout uint seed) {
+  // random int in [mi, mx]
+  return min(mi + int(random_double(seed) * float(mx - mi + 1)), mx);
+}
+vec3 random_vec(inout uint seed) {
+  // random vector
+  return vec3(random_double(seed), random_double(seed), random_double(seed));
+}
+vec3 random_vec(float mi, float ma, inout uint seed) {
+  // random vector in given seed
+  return vec3(random_double(mi, ma, seed), random_double(mi, ma, seed),
+              random_double(mi, ma, seed));
+}
+vec3 to_unit(vec3 v) { return normalize(v); }
+float length_squared(vec3 v) { return dot(v, v); }
+vec2 to_spheric(vec3 v) {
+  //
+  //
+  vec3 v2 = to_unit(v);
+  return vec2(atan(v2.x, v2.z), asin(v2.y)); // phi, theta
+}
+#endif
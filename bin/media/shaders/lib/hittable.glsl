@@ -0,0 +1,232 @@
+// spheres in the scene buffer and the bvh walk, SPHERE_UV adds
+// texture coordinates to the hit record
+#ifndef HITTABLE_GLSL
+#define HITTABLE_GLSL
+#include "functions.glsl"
+#include "ray.glsl"
+#include "scene.glsl"
+struct HitRecord {
+  vec3 point;
+  vec3 normal;
+  float dist;
+  bool front_face;
+#ifdef SPHERE_UV
+  float u, v; // texture coordinates
+#endif
+  int obj_index; // index of the hit object in the scene buffer
+};
+void set_face_normal(inout HitRecord rec, in Ray r, in vec3 out_normal) {
+  // set face normal to hit record did we hit front or back
+  rec.front_face = dot(r.direction, out_normal) < 0;
+  rec.normal = (rec.front_face) ? out_normal : -1 * out_normal;
+}
+struct Sphere {
+  vec3 center;
+  float radius;
+};
+Sphere makeSphere(vec3 cent, float r) {
+  Sphere sp;
+  sp.center = cent;
+  sp.radius = r;
+  return sp;
+}
+#ifdef SPHERE_UV
+void get_sphere_uv(in vec3 p, out float u, out float v) {
+  //
+  float phi = atan(p.z, p.x);
+  float theta = asin(p.y);
+  u = 1 - (phi + PI) / (2 * PI);
+  v = (theta + PI / 2) / PI;
+}
+#endif
+bool hitSphere(in Sphere s, in Ray r, float dist_min, float dist_max,
+               inout HitRecord record) {
+  // kureye isin vurdu mu onu test eden fonksiyon
+  vec3 origin_to_center = r.origin - s.center;
+  float a = dot(r.direction, r.direction);
+  float half_b = dot(origin_to_center, r.direction);
+  float c = dot(origin_to_center, origin_to_center) - s.radius * s.radius;
+  float isHit = half_b * half_b - a * c;
+  float margin;
+  if (isHit > 0) {
+    float root = sqrt(isHit);
+    margin = (-1 * half_b - root) / a;
+    if (margin < dist_max && margin > dist_min) {
+      record.dist = margin;
+      record.point = at(r, record.dist);
+      vec3 out_normal = (record.point - s.center) / s.radius;
+      set_face_normal(record, r, out_normal);
+#ifdef SPHERE_UV
+      get_sphere_uv(out_normal, record.u, record.v);
+#endif
+      return true;
+    }
+    margin = (-1 * half_b + root) / a;
+    if (margin < dist_max && margin > dist_min) {
+      record.dist = margin;
+      record.point = at(r, record.dist);
+      vec3 out_normal = (record.point - s.center) / s.radius;
+      set_face_normal(record, r, out_normal);
+#ifdef SPHERE_UV
+      get_sphere_uv(out_normal, record.u, record.v);
+#endif
+      return true;
+    }
+  }
+  return false;
+}
+bool hitBox(in BvhNode n, in Ray r, vec3 inv_dir, float dmin, float dmax) {
+  // slab test against the node box
+  vec3 t0 = (n.bmin.xyz - r.origin) * inv_dir;
+  vec3 t1 = (n.bmax.xyz - r.origin) * inv_dir;
+  vec3 tsmall = min(t0, t1);
+  vec3 tbig = max(t0, t1);
+  float tnear = max(dmin, max(tsmall.x, max(tsmall.y, tsmall.z)));
+  float tfar = min(dmax, min(tbig.x, min(tbig.y, tbig.z)));
+  return tnear <= tfar;
+}
+#ifdef BVH4
+// four wide bvh of src/bvh4.hpp, the host defines BVH4_BITS and the stack
+// size BVH4_STACK of its tree
+#if BVH4_BITS == 16
+#define BVH4_VECTORS 6
+vec4 unpack_bounds(uint pair01, uint pair23) {
+  // bounds of children 0 and 1, then 2 and 3, 16 bits each
+  return vec4(pair01 & 0xffffu, pair01 >> 16, pair23 & 0xffffu,
+              pair23 >> 16);
+}
+#else
+#define BVH4_VECTORS 4
+vec4 unpack_bounds(uint bytes, uint unused) {
+  // a byte per child
+  return vec4(bytes & 0xffu, (bytes >> 8) & 0xffu, (bytes >> 16) & 0xffu,
+              bytes >> 24);
+}
+#endif
+bool hit_scene(in Ray r, float dmin, float dmax, inout HitRecord record) {
+  // test the four child boxes of a node at once, the spheres of the hit
+  // leaves right away, and go on with the nearest hit inner child. The
+  // other hit inner children wait on a stack, nearest on top, and are
+  // skipped once a closer hit is found.
+  HitRecord temp;
+  bool hit_ = false;
+  float current_closest = dmax;
+  vec3 inv_dir = 1.0 / r.direction;
+  int stack[BVH4_STACK];
+  float stack_near[BVH4_STACK];
+  int top = 0;
+  int node = 0;
+  while (node != -1) {
+    uint base = uint(node) * BVH4_VECTORS;
+    uvec4 head = wide_nodes[base];
+    uvec4 lo = wide_nodes[base + 1];
+    uvec4 hi = wide_nodes[base + 2];
+#if BVH4_BITS == 16
+    uvec4 lo23 = wide_nodes[base + 3];
+    uvec4 hi23 = wide_nodes[base + 4];
+#else
+    uvec4 lo23 = lo;
+    uvec4 hi23 = hi;
+#endif
+    ivec4 children = ivec4(wide_nodes[base + BVH4_VECTORS - 1]);
+    // child bounds are origin + q * 2^e, exact in the same floats as on
+    // the host
+    vec3 origin = uintBitsToFloat(head.xyz);
+    int exponents = int(head.w);
+    vec3 scale = ldexp(vec3(1.0), ivec3(bitfieldExtract(exponents, 0, 8),
+                                        bitfieldExtract(exponents, 8, 8),
+                                        bitfieldExtract(exponents, 16, 8)));
+    vec4 lx = (origin.x + unpack_bounds(lo.x, lo23.x) * scale.x - r.origin.x) *
+              inv_dir.x;
+    vec4 hx = (origin.x + unpack_bounds(hi.x, hi23.x) * scale.x - r.origin.x) *
+              inv_dir.x;
+    vec4 ly = (origin.y + unpack_bounds(lo.y, lo23.y) * scale.y - r.origin.y) *
+              inv_dir.y;
+    vec4 hy = (origin.y + unpack_bounds(hi.y, hi23.y) * scale.y - r.origin.y) *
+              inv_dir.y;
+    vec4 lz = (origin.z + unpack_bounds(lo.z, lo23.z) * scale.z - r.origin.z) *
+              inv_dir.z;
+    vec4 hz = (origin.z + unpack_bounds(hi.z, hi23.z) * scale.z - r.origin.z) *
+              inv_dir.z;
+    vec4 tnear = max(max(min(lx, hx), min(ly, hy)), max(min(lz, hz), dmin));
+    vec4 tfar = min(min(max(lx, hx), max(ly, hy)),
+                    min(max(lz, hz), current_closest));
+    uvec4 counts = (uvec4(lo.w) >> uvec4(0, 8, 16, 24)) & 0xffu;
+    int first = top;
+    for (int k = 0; k < 4; k++) {
+      if (children[k] == -1 || tnear[k] > tfar[k]) {
+        continue;
+      }
+      if (counts[k] == 0u) {
+        int s = top++;
+        stack[s] = children[k];
+        stack_near[s] = tnear[k];
+        while (s > first && stack_near[s - 1] < stack_near[s]) {
+          int n = stack[s];
+          float d = stack_near[s];
+          stack[s] = stack[s - 1];
+          stack_near[s] = stack_near[s - 1];
+          stack[s - 1] = n;
+          stack_near[s - 1] = d;
+          s--;
+        }
+        continue;
+      }
+      if (tnear[k] > current_closest) {
+        continue;
+      }
+      for (int i = children[k]; i < children[k] + int(counts[k]); i++) {
+        Sphere sp = makeSphere(objects[i].sphere_center.xyz,
+                               objects[i].sphere_radius);
+        if (hitSphere(sp, r, dmin, current_closest, temp)) {
+          hit_ = true;
+          current_closest = temp.dist;
+          temp.obj_index = i;
+          record = temp;
+        }
+      }
+    }
+    node = -1;
+    while (top > 0) {
+      top--;
+      if (stack_near[top] <= current_closest) {
+        node = stack[top];
+        break;
+      }
+    }
+  }
+  return hit_;
+}
+#else
+bool hit_scene(in Ray r, float dmin, float dmax, inout HitRecord record) {
+  // walk the bvh without a stack: descend into hit boxes, follow the miss
+  // link when a box is missed or a leaf is done
+  HitRecord temp;
+  bool hit_ = false;
+  float current_closest = dmax;
+  vec3 inv_dir = 1.0 / r.direction;
+  int node = 0;
+  while (node != -1) {
+    BvhNode n = nodes[node];
+    if (hitBox(n, r, inv_dir, dmin, current_closest)) {
+      if (n.count == 0) {
+        node = n.left;
+        continue;
+      }
+      for (int i = n.left; i < n.left + n.count; i++) {
+        Sphere sp = makeSphere(objects[i].sphere_center.xyz,
+                               objects[i].sphere_radius);
+        if (hitSphere(sp, r, dmin, current_closest, temp)) {
+          hit_ = true;
+          current_closest = temp.dist;
+          temp.obj_index = i;
+          record = temp;
+        }
+      }
+    }
+    node = n.miss;
+  }
+  return hit_;
+}
+#endif
+#endif
@@ -0,0 +1,91 @@
+// path tracing loop of the megakernels: the color of a camera ray, the
+// pixel of an invocation and the gamma corrected average of the samples.
+// The kernel declares img_output before the include. NO_ATTENUATION keeps
+// the sky color of a path without the surface colors it bounced off.
+#ifndef INTEGRATOR_GLSL
+#define INTEGRATOR_GLSL
+#include "functions.glsl"
+#include "sampler.glsl"
+#include "ray.glsl"
+#include "params.glsl"
+#include "hittable.glsl"
+#include "material.glsl"
+uniform int rr_depth; // bounces before russian roulette starts
+#ifdef ADAPTIVE
+// adaptive sampling: only the tiles that have not converged are dispatched
+layout(std430, binding = 3) readonly buffer TileList {
+  int active_tiles[]; // y * tiles_x + x of the tiles, one work group each
+};
+#endif
+
+vec3 fix_color(vec3 pcolor, int samples_per_pixel) {
+  // scale sample
+  pcolor /= samples_per_pixel;
+  return clamp(sqrt(pcolor), 0.0, 1.0);
+}
+
+vec3 ray_color(in Ray r, int depth, inout Sampler smp) {
+  //
+  Ray r_in;
+  r_in.origin = r.origin;
+  r_in.direction = r.direction;
+  vec3 bcolor = vec3(1);
+  int max_depth = depth;
+
+  while (true) {
+    if (depth <= 0) {
+      //
+      return vec3(0);
+      // return bcolor;
+    }
+    HitRecord rec;
+    if (hit_scene(r_in, 0.001, INFINITY, rec)) {
+      start_bounce(smp, max_depth - depth);
+      float survive = roulette_sample(smp, max_depth - depth);
+      Ray r_out;
+      vec3 atten;
+      if (scatter(getMaterial(rec.obj_index), r_in, rec, atten, r_out,
+                  smp) == true) {
+        r_in = r_out;
+#ifndef NO_ATTENUATION
+        bcolor *= atten;
+#endif
+        depth--;
+        if (max_depth - depth >= rr_depth) {
+          // russian roulette on the throughput, the survivors are scaled
+          // up by the paths that were cut
+          float p = min(max(bcolor.x, max(bcolor.y, bcolor.z)), 1.0);
+          if (survive >= p) {
+            return vec3(0);
+          }
+          bcolor /= p;
+        }
+      } else {
+        return vec3(0);
+      }
+    } else {
+      vec3 dir = normalize(r_in.direction);
+      float temp = 0.5 * (dir.y + 1.0);
+      bcolor *= vec3(1.0 - temp) + temp * vec3(0.5, 0.7, 1.0);
+      return bcolor;
+    }
+  }
+}
+
+ivec2 invocation_pixel() {
+  // pixel of this invocation, with adaptive sampling the work group is
+  // mapped to its tile through the active tile list. A preview takes the
+  // corner pixel of each block.
+  if (preview_step > 1) {
+    return ivec2(gl_GlobalInvocationID.xy) * preview_step;
+  }
+#ifdef ADAPTIVE
+  int tiles_x = (imageSize(img_output).x + TILE_W - 1) / TILE_W;
+  int tile = active_tiles[gl_WorkGroupID.x];
+  ivec2 origin = ivec2(tile % tiles_x, tile / tiles_x) * ivec2(TILE_W, TILE_H);
+  return origin + ivec2(gl_LocalInvocationID.xy);
+#else
+  return ivec2(gl_GlobalInvocationID.xy);
+#endif
+}
+#endif
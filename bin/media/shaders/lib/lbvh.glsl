@@ -0,0 +1,44 @@
+// buffers of the lbvh build: morton codes of the sphere centers are radix
+// sorted, the sorted codes give the hierarchy and the boxes are fitted
+// bottom up. Storage bindings 8 to 13, next to the scene at 0 and 1.
+#ifndef LBVH_GLSL
+#define LBVH_GLSL
+#ifndef WAVE_SIZE
+#define WAVE_SIZE 256 // items per work group
+#endif
+#define SORT_BITS 4 // bits of the key sorted by one pass
+#define SORT_BINS 16
+
+uniform int object_count;
+
+layout(std430, binding = 8) buffer LbvhState {
+  uint center_min[3]; // box of the centers, as ordered bits, see float_order
+  uint center_max[3];
+};
+layout(std430, binding = 9) buffer SortIn {
+  uvec2 sort_in[]; // x: morton code, y: object index
+};
+layout(std430, binding = 10) buffer SortOut {
+  uvec2 sort_out[]; // sort_in ordered by the digit of the pass
+};
+layout(std430, binding = 11) buffer SortHistogram {
+  uint histogram[]; // digit major: digit * work groups + work group
+};
+layout(std430, binding = 12) buffer LbvhParents {
+  int parents[]; // parent of every node, -1 for the root
+};
+layout(std430, binding = 13) buffer LbvhFlags {
+  uint flags[]; // children of an inner node whose box is done
+};
+
+uint float_order(float x) {
+  // bits of a float that compare as unsigned like the float does, so that
+  // atomicMin and atomicMax work on them
+  uint u = floatBitsToUint(x);
+  return (u & 0x80000000u) != 0u ? ~u : u | 0x80000000u;
+}
+float order_float(uint u) {
+  return uintBitsToFloat((u & 0x80000000u) != 0u ? u & 0x7fffffffu : ~u);
+}
+
+#endif
@@ -0,0 +1,192 @@
+// lambert, metal and dielectric materials of the weekend scenes. Kernels
+// for scenes without metal or glass define NO_METAL or NO_DIELECTRIC and
+// lose that branch of scatter. Kernels with textured lambert surfaces define
+// LAMBERT_TEXTURED and, before the include, a Texture with
+// makeTexture(NHittable) and textureValue(Texture, u, v, p).
+#ifndef MATERIAL_GLSL
+#define MATERIAL_GLSL
+#ifndef FRESNEL_CHOICE
+#define FRESNEL_CHOICE 1 // 0: schlick, 1: cook torrance
+#endif
+#include "functions.glsl"
+#include "sampler.glsl"
+#include "ray.glsl"
+#include "scene.glsl"
+#include "hittable.glsl"
+#ifdef LAMBERT_TEXTURED
+struct Lambert {
+  Texture albedo;
+};
+Lambert makeLambert(Texture t) {
+  Lambert lam;
+  lam.albedo = t;
+  return lam;
+}
+vec3 lambertColor(Lambert lam, in HitRecord record) {
+  //
+  return textureValue(lam.albedo, record.u, record.v, record.point);
+}
+#else
+struct Lambert {
+  vec3 albedo;
+};
+Lambert makeLambert(vec3 clr) {
+  Lambert lam;
+  lam.albedo = clr;
+  return lam;
+}
+vec3 lambertColor(Lambert lam, in HitRecord record) { return lam.albedo; }
+#endif
+bool scatterLambert(Lambert lam, in Ray ray_in, in HitRecord record,
+                    inout vec3 attenuation, inout Ray ray_out,
+                    inout Sampler smp) {
+
+  // isik kirilsin mi kirilmasin mi
+#ifdef LAMBERT_COSINE
+  // cosine weighted around the normal, as in the next week kernels
+  vec3 out_dir = record.normal + random_unit_vector(smp);
+#else
+  vec3 out_dir = record.point + random_in_hemisphere(record.normal, smp);
+#endif
+  ray_out = makeRay(record.point, out_dir);
+  attenuation = lambertColor(lam, record);
+  return true;
+}
+struct Metal {
+  vec3 albedo;
+  float roughness;
+};
+Metal makeMetal(vec3 alb, float fuzz) {
+  Metal m;
+  m.albedo = alb;
+  m.roughness = fuzz;
+  return m;
+}
+#ifndef NO_METAL
+bool scatterMetal(Metal met, in Ray ray_in, in HitRecord record,
+                  out vec3 attenuation, out Ray ray_out, inout Sampler smp) {
+
+  vec3 unit_in_dir = normalize(ray_in.direction);
+  vec3 out_dir = reflect(unit_in_dir, record.normal);
+  ray_out =
+      makeRay(record.point,
+              out_dir + met.roughness * random_in_unit_sphere(smp));
+  attenuation = met.albedo;
+  return dot(ray_out.direction, record.normal) > 0.0;
+}
+#endif
+struct Dielectric {
+  float ref_idx;
+};
+Dielectric makeDielectric(float rfidx) {
+  Dielectric die;
+  die.ref_idx = rfidx;
+  return die;
+}
+#ifndef NO_DIELECTRIC
+float fresnelCT(float costheta, float ridx) {
+  // cook torrence fresnel equation
+  float etao = 1 + sqrt(ridx);
+  float etau = 1 - sqrt(ridx);
+  float eta = etao / etau;
+  float g = sqrt(pow(eta, 2) + pow(costheta, 2) - 1);
+  float g_c = g - costheta;
+  float gplusc = g + costheta;
+  float gplus_cc = (gplusc * costheta) - 1;
+  float g_cc = (g_c * costheta) + 1;
+  float oneplus_gcc = 1 + pow(gplus_cc / g_cc, 2);
+  float half_plus_minus = 0.5 * pow(g_c / gplusc, 2);
+  return half_plus_minus * oneplus_gcc;
+}
+float fresnelSchlick(float costheta, float ridx) {
+  //
+  float r0 = (1 - ridx) / (1 + ridx);
+  r0 = r0 * r0;
+  return r0 + (1 - r0) * pow((1 - costheta), 5);
+}
+float get_fresnel(float costheta, float ridx, int choice) {
+  // compute freshnel
+  float fresnel;
+  if (choice == 0) {
+    fresnel = fresnelSchlick(costheta, ridx);
+  } else if (choice == 1) {
+    fresnel = fresnelCT(costheta, ridx);
+  }
+  return fresnel;
+}
+bool scatterDielectric(Dielectric diel, in Ray r_in, in HitRecord record,
+                       out vec3 attenuation, out Ray r_out, inout Sampler smp) {
+  // ray out
+  attenuation = vec3(1.0);
+  vec3 unit_in_dir = to_unit(r_in.direction);
+  float eta_over = record.front_face ? 1.0 / diel.ref_idx : diel.ref_idx;
+  float costheta = min(dot(-1 * unit_in_dir, record.normal), 1.0);
+  float sintheta = sqrt(1.0 - costheta * costheta);
+  vec3 ref;
+  if (eta_over * sintheta > 1.0) {
+    //
+    ref = reflect(unit_in_dir, record.normal);
+    r_out = makeRay(record.point, ref);
+    return true;
+  }
+  //
+  float fresnel_term = get_fresnel(costheta, eta_over, FRESNEL_CHOICE);
+  if (sample_1d(smp) < fresnel_term) {
+    ref = reflect(unit_in_dir, record.normal);
+    r_out = makeRay(record.point, ref);
+    return true;
+  }
+  ref = refract(unit_in_dir, record.normal, eta_over);
+  r_out = makeRay(record.point, ref);
+  return true;
+}
+#endif
+struct Material {
+  int type; // 0: lambert, 1: metal, 2: dielectric;
+  Lambert lam;
+  Metal met;
+  Dielectric die;
+};
+Material getMaterial(int obj_index) {
+  // material of a scene object as stored in the scene buffer
+  NHittable obj = objects[obj_index];
+  Material m;
+  m.type = obj.material_type;
+  if (obj.material_type == 0) {
+#ifdef LAMBERT_TEXTURED
+    m.lam = makeLambert(makeTexture(obj));
+#else
+    m.lam = makeLambert(obj.lambert_albedo.xyz);
+#endif
+#ifndef NO_METAL
+  } else if (obj.material_type == 1) {
+    m.met = makeMetal(obj.metal_albedo.xyz, obj.metal_roughness);
+#endif
+#ifndef NO_DIELECTRIC
+  } else if (obj.material_type == 2) {
+    m.die = makeDielectric(obj.dielectric_ref_idx);
+#endif
+  }
+  return m;
+}
+bool scatter(Material mat_ptr, in Ray ray_in, in HitRecord record,
+             inout vec3 attenuation, inout Ray ray_out, inout Sampler smp) {
+  // scatter material
+  if (mat_ptr.type == 0) {
+    return scatterLambert(mat_ptr.lam, ray_in, record, attenuation, ray_out,
+                          smp);
+#ifndef NO_METAL
+  } else if (mat_ptr.type == 1) {
+    return scatterMetal(mat_ptr.met, ray_in, record, attenuation, ray_out,
+                        smp);
+#endif
+#ifndef NO_DIELECTRIC
+  } else if (mat_ptr.type == 2) {
+    return scatterDielectric(mat_ptr.die, ray_in, record, attenuation, ray_out,
+                             smp);
+#endif
+  } else {
+    return false;
+  }
+}
+#endif
@@ -0,0 +1,46 @@
+// camera and frame parameters computed on the host, see src/camera.hpp
+#ifndef PARAMS_GLSL
+#define PARAMS_GLSL
+#include "camera.glsl"
+layout(std140, binding = 0) uniform RenderParams {
+  vec4 cam_origin;     // xyz: camera origin, w: lens radius
+  vec4 cam_lower_left; // xyz: lower left corner of the focus plane
+  vec4 cam_horizontal;
+  vec4 cam_vertical;
+  vec4 cam_u;
+  vec4 cam_v;
+  vec4 cam_w;
+  vec2 cam_shutter;  // open and close times
+  int max_depth;     // bounces of a path, 0 keeps MAX_DEPTH
+  int frame_samples; // samples added by this dispatch, 0 uses psample
+  int frame_index;   // frames accumulated so far, 0 restarts the sum
+  int preview_step;  // 1 renders every pixel, n one pixel per n x n block
+};
+Camera paramsCamera() {
+  // the same for every pixel, nothing left to compute
+  Camera cam;
+  cam.lower_left_corner = cam_lower_left.xyz;
+  cam.origin = cam_origin.xyz;
+  cam.vertical = cam_vertical.xyz;
+  cam.horizontal = cam_horizontal.xyz;
+  cam.u = cam_u.xyz;
+  cam.v = cam_v.xyz;
+  cam.w = cam_w.xyz;
+  cam.lens_radius = cam_origin.w;
+  cam.time0 = cam_shutter.x;
+  cam.time1 = cam_shutter.y;
+  return cam;
+}
+void store_preview(ivec2 pixel_index, vec3 color) {
+  // fill the block of a preview pixel in the img_output of the kernel
+  ivec2 img_dims = imageSize(img_output);
+  for (int y = 0; y < preview_step; y++) {
+    for (int x = 0; x < preview_step; x++) {
+      ivec2 p = pixel_index + ivec2(x, y);
+      if (p.x < img_dims.x && p.y < img_dims.y) {
+        imageStore(img_output, p, vec4(color, 1.0));
+      }
+    }
+  }
+}
+#endif
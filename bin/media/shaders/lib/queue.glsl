@@ -0,0 +1,12 @@
+// lengths of the queue pair of the wavefront bounces and the adaptive
+// passes, see src/window.hpp for the host side
+#ifndef QUEUE_GLSL
+#define QUEUE_GLSL
+layout(std430, binding = 5) buffer QueueState {
+  uint in_count;  // length of the current queue
+  uint out_count; // length of the next queue
+  uint groups_x;  // indirect dispatch size of the next pass
+  uint groups_y;
+  uint groups_z;
+};
+#endif
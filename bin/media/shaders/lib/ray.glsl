@@ -0,0 +1,21 @@
+// ray with an origin and a direction
+#ifndef RAY_GLSL
+#define RAY_GLSL
+struct Ray {
+  /*N = C + mY
+N: nokta
+C: cikis yeri
+m: mesafe/buyukluk
+Y: yonu
+   */
+  vec3 origin;
+  vec3 direction;
+};
+Ray makeRay(vec3 orig, vec3 dir) {
+  Ray r;
+  r.origin = orig;
+  r.direction = dir;
+  return r;
+}
+vec3 at(Ray r, float dist) { return r.direction * dist + r.origin; }
+#endif
@@ -0,0 +1,110 @@
+// owen scrambled sobol points and the directions drawn from them
+#ifndef SAMPLER_GLSL
+#define SAMPLER_GLSL
+#include "functions.glsl"
+#ifndef SOBOL_DIMS
+#define SOBOL_DIMS 16 // dimensions in the direction table
+#endif
+layout(std430, binding = 6) readonly buffer SobolBuffer {
+  uint sobol_directions[]; // 32 direction numbers per dimension
+};
+struct Sampler {
+  uint index; // shuffled sample index of the pixel
+  uint seed;  // scramble seed of the pixel
+  int dim;    // next dimension to draw
+};
+uint sobol(uint index, int dim) {
+  // sobol point along one dimension: xor of the direction numbers of the
+  // set bits of the index, dimensions past the table wrap around and are
+  // decorrelated by sample_1d
+  uint x = 0u;
+  int base = (dim % SOBOL_DIMS) * 32;
+  for (int bit = 0; index != 0u; bit++) {
+    if ((index & 1u) != 0u) {
+      x ^= sobol_directions[base + bit];
+    }
+    index >>= 1;
+  }
+  return x;
+}
+uint laine_karras(uint x, uint seed) {
+  // hash where a bit only depends on the bits below it
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+uint owen_scramble(uint x, uint seed) {
+  // nested uniform scramble, a bit only depends on the bits above it
+  return bitfieldReverse(laine_karras(bitfieldReverse(x), seed));
+}
+Sampler makeSampler(ivec2 pixel, int sample_index) {
+  // sampler of one pixel sample, the index shuffle decorrelates pixels
+  Sampler s;
+  s.seed = pcg_hash(pcg_hash(uint(pixel.x)) ^ uint(pixel.y));
+  s.index = owen_scramble(uint(sample_index), s.seed);
+  s.dim = 0;
+  return s;
+}
+float sample_1d(inout Sampler s) {
+  // next dimension of the sample point, in [0, 1). Every wrap of the
+  // direction table shuffles the index with its own seed, so dimension d and
+  // d + SOBOL_DIMS are not drawn from the same point.
+  uint wrap = uint(s.dim / SOBOL_DIMS);
+  uint index =
+      wrap == 0u ? s.index : owen_scramble(s.index, pcg_hash(s.seed ^ wrap));
+  uint x = owen_scramble(sobol(index, s.dim), pcg_hash(s.seed ^ uint(s.dim)));
+  s.dim++;
+  return float(x >> 8) / 16777216.0;
+}
+vec2 sample_2d(inout Sampler s) {
+  float x = sample_1d(s);
+  float y = sample_1d(s);
+  return vec2(x, y);
+}
+void start_bounce(inout Sampler s, int bounce) {
+  // dimensions 0, 1 jitter the pixel, 2, 3 the lens, then bounce 0, 1, ...
+  // of the path reads its own block of 4, counted from the camera so paths
+  // of any length share the dimensions of their first bounces
+  s.dim = 4 + 4 * bounce;
+}
+float roulette_sample(Sampler s, int bounce) {
+  // last dimension of the bounce block, scattering draws 3 at most
+  s.dim = 4 + 4 * bounce + 3;
+  return sample_1d(s);
+}
+vec3 random_in_unit_sphere(inout Sampler smp) {
+  // uniform point in the unit ball from 3 sampler dimensions
+  vec3 u = vec3(sample_2d(smp), sample_1d(smp));
+  float z = 1 - 2 * u.x;
+  float r = sqrt(max(0.0, 1 - z * z));
+  float a = 2 * PI * u.y;
+  return pow(u.z, 1.0 / 3.0) * vec3(r * cos(a), r * sin(a), z);
+}
+vec3 random_unit_vector(inout Sampler smp) {
+  // unit vector
+  vec2 u = sample_2d(smp);
+  float a = 2 * PI * u.x;
+  float z = 2 * u.y - 1;
+  float r = sqrt(1 - z * z);
+  return vec3(r * cos(a), r * sin(a), z);
+}
+vec3 random_in_hemisphere(vec3 normal, inout Sampler smp) {
+  // normal ekseninde dagilan yon
+  vec3 unit_sphere_dir = random_in_unit_sphere(smp);
+  if (dot(unit_sphere_dir, normal) > 0.0) {
+    return unit_sphere_dir;
+  } else {
+    return -1 * unit_sphere_dir;
+  }
+}
+vec3 random_in_unit_disk(inout Sampler smp) {
+  // lens yakinsamasi için gerekli, uniform point of the unit disk
+  vec2 u = sample_2d(smp);
+  float r = sqrt(u.x);
+  float a = 2 * PI * u.y;
+  return vec3(r * cos(a), r * sin(a), 0);
+}
+#endif
@@ -0,0 +1,45 @@
+// scene and bvh buffers, the bvh comes from the host or the lbvh kernels
+#ifndef SCENE_GLSL
+#define SCENE_GLSL
+struct NHittable {
+  vec4 sphere_center;  // xyz: sphere center
+  vec4 lambert_albedo; // solid color, odd color of checkered texture
+  vec4 checker_even;   // even color of checkered texture
+  vec4 metal_albedo;
+  int hittable_type;   // 0: sphere
+  int material_type;   // 0: lambert, 1: metal, 2: dielectric
+  int texture_type;    // 0: solid, 1: checkered, 2: image, 3: noise
+  float sphere_radius;
+  float metal_roughness;
+  float dielectric_ref_idx;
+  float noise_scale;
+  float pad;
+};
+layout(std430, binding = 0) readonly buffer SceneBuffer {
+  NHittable objects[];
+};
+struct BvhNode {
+  vec4 bmin; // xyz: box min
+  vec4 bmax; // xyz: box max
+  int left;  // first child of inner nodes, first object of leaves
+  int right; // second child of inner nodes
+  int count; // object count of leaves, 0 for inner nodes
+  int miss;  // next node when the box is missed or the leaf is done
+};
+#if defined(BVH4)
+// four wide nodes of BVH4_VECTORS vectors each, see src/bvh4.hpp
+layout(std430, binding = 1) readonly buffer Bvh4Buffer {
+  uvec4 wide_nodes[]; // the root is the first node
+};
+#else
+#ifdef BVH_BUILD
+// the lbvh kernels write the nodes, the fit pass reads boxes other
+// invocations wrote
+layout(std430, binding = 1) coherent buffer BvhBuffer {
+#else
+layout(std430, binding = 1) readonly buffer BvhBuffer {
+#endif
+  BvhNode nodes[]; // nodes[0] is the root, the miss links give the order
+};
+#endif
+#endif
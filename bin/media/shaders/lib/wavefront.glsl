@@ -0,0 +1,19 @@
+// path state of the wavefront kernels, see src/wavefront.hpp
+#ifndef WAVEFRONT_GLSL
+#define WAVEFRONT_GLSL
+struct Path {
+  vec4 origin;       // xyz: ray origin
+  vec4 direction;    // xyz: ray direction
+  vec4 throughput;   // xyz: attenuation gathered along the path
+  vec4 radiance;     // xyz: color of the path once it is done
+  vec4 hit_point;    // xyz: closest hit point, w: hit distance
+  vec4 hit_normal;   // xyz: normal facing the ray, w: 1 for front face
+  int obj_index;     // hit object in the scene buffer, -1 for a miss
+  int depth;         // bounces left before the path is cut
+  uint sample_index; // shuffled sobol index of the path's sample
+  uint sample_seed;  // sobol scramble seed of the pixel
+};
+layout(std430, binding = 2) buffer PathBuffer {
+  Path paths[]; // one path per pixel
+};
+#endif
@@ -3,6 +3,9 @@
 
 // includes
 #include <GL/glext.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -10,30 +13,42 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-void checkShaderCompilation(GLuint shader, const char *shaderType) {
+// linked programs are saved here and loaded back on later runs, keyed by a
+// hash of their sources and the driver. Empty turns the cache off.
+std::string SHADER_CACHE_DIR = "shader_cache";
+
+bool checkShaderCompilation(GLuint shader, const char *shaderType) {
   // check the shader compilation
   int success;
-  char infoLog[512];
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
   if (success == 0) {
-    glGetShaderInfoLog(shader, 512, NULL, infoLog);
+    // the whole log, long kernels fail with long logs
+    GLint logLength = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<char> infoLog(std::max(logLength, 1), '\0');
+    glGetShaderInfoLog(shader, infoLog.size(), NULL, infoLog.data());
     std::cout << "ERROR::SHADER::" << shaderType << "::COMPILATION_FAILED\n"
-              << infoLog << std::endl;
+              << infoLog.data() << std::endl;
   }
+  return success != 0;
 }
 
 void checkShaderProgramCompilation(GLuint program) {
   // check the shader compilation
   int success;
-  char infoLog[512];
   glGetProgramiv(program, GL_LINK_STATUS, &success);
   if (success == 0) {
-    glGetProgramInfoLog(program, 512, NULL, infoLog);
+    GLint logLength = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<char> infoLog(std::max(logLength, 1), '\0');
+    glGetProgramInfoLog(program, infoLog.size(), NULL, infoLog.data());
     std::cout << "ERROR::SHADER::"
               << "PROGRAM"
               << "::LINK_FAILED\n"
-              << infoLog << std::endl;
+              << infoLog.data() << std::endl;
   }
 }
 void checkUniformLocation(int locVal, const char *uniName) {
@@ -47,175 +62,510 @@ void checkUniformLocation(int locVal, const std::string &uniName) {
   checkUniformLocation(locVal, uniName.c_str());
 }
 
+struct ShaderSource {
+  GLenum type;
+  const char *typeName; // for the error messages
+  std::string code;     // with the defines injected and the includes expanded
+  std::vector<std::string> files; // source string numbers of the #line lines
+};
+
+// active uniform or block of a linked program
+struct ShaderResource {
+  GLint location; // uniform location, binding point of blocks
+  GLenum type;    // glsl type of uniforms, 0 for blocks
+  GLint size;     // array size of uniforms, buffer size of blocks in bytes
+};
+typedef std::unordered_map<std::string, ShaderResource> ShaderResources;
+
 class Shader {
 public:
   // program id
   GLuint programId;
+  // reflection of the program, filled once after linking
+  ShaderResources uniforms;
+  ShaderResources uniformBlocks;
+  ShaderResources storageBlocks;
 
+  // empty program, for shaders that are only built on demand
+  Shader() : programId(0) {}
   // constructor takes the path of the shaders and builts them
   Shader(const GLchar *vertexPath, const GLchar *fragmentPath);
   Shader(const GLchar *computePath);
+  Shader(const GLchar *computePath, const std::string &defines);
   Shader(const GLchar *vertexPath, const GLchar *fragmentPath,
          const GLchar *computePath);
 
   void useProgram();
 
+  // lookups in the reflected resources, -1 or false when the program does
+  // not use the name
+  GLint uniformLocation(const std::string &name) const {
+    auto it = uniforms.find(name);
+    return it == uniforms.end() ? -1 : it->second.location;
+  }
+  bool hasUniform(const std::string &name) const {
+    return uniforms.count(name) != 0;
+  }
+  bool hasUniformBlock(const std::string &name) const {
+    return uniformBlocks.count(name) != 0;
+  }
+  bool hasStorageBlock(const std::string &name) const {
+    return storageBlocks.count(name) != 0;
+  }
+  // bind a buffer to the binding point of a block of the program
+  bool bindUniformBlock(const std::string &name, GLuint buffer) const {
+    return bindBlock(uniformBlocks, GL_UNIFORM_BUFFER, name, buffer);
+  }
+  bool bindStorageBlock(const std::string &name, GLuint buffer) const {
+    return bindBlock(storageBlocks, GL_SHADER_STORAGE_BUFFER, name, buffer);
+  }
+
   // utility functions for setting uniforms
   void setBoolUni(const char *name, bool value) const {
     // set boolean value to given uniform name
-    int uniLocation = glGetUniformLocation(programId, name);
-    checkUniformLocation(uniLocation, name);
-    glUniform1i(uniLocation, static_cast<int>(value));
+    setBoolUni(std::string(name), value);
   };
 
   void setBoolUni(const std::string &name, bool value) const {
     // set boolean value to given uniform name
-    setBoolUni(name.c_str(), value);
+    int uniLocation = uniformLocation(name);
+    checkUniformLocation(uniLocation, name);
+    glUniform1i(uniLocation, static_cast<int>(value));
   };
   void setIntUni(const char *name, int value) const {
     // set boolean value to given uniform name
-    int uniLocation = glGetUniformLocation(programId, name);
-    checkUniformLocation(uniLocation, name);
-    glUniform1i(uniLocation, value);
+    setIntUni(std::string(name), value);
   };
 
   void setIntUni(const std::string &name, int value) const {
     // set boolean value to given uniform name
-    setIntUni(name.c_str(), value);
+    int uniLocation = uniformLocation(name);
+    checkUniformLocation(uniLocation, name);
+    glUniform1i(uniLocation, value);
   };
   void setFloatUni(const std::string &name, float value) const {
     // set boolean value to given uniform name
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform1f(uniLocation, value);
   };
   void setVec2Uni(const std::string &name, const glm::vec2 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform2fv(uniLocation, 1, glm::value_ptr(value));
   }
   void setVec2Uni(const std::string &name, float x, float y) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform2f(uniLocation, x, y);
   }
   void setVec3Uni(const std::string &name, const glm::vec3 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform3fv(uniLocation, 1, glm::value_ptr(value));
   }
   void setVec3Uni(const std::string &name, float x, float y, float z) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform3f(uniLocation, x, y, z);
   }
   void setVec4Uni(const std::string &name, const glm::vec4 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform4fv(uniLocation, 1, glm::value_ptr(value));
   }
   void setVec4Uni(const std::string &name, float x, float y, float z,
                   float w) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniform4f(uniLocation, x, y, z, w);
   }
   void setMat2Uni(const std::string &name, glm::mat2 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniformMatrix2fv(uniLocation, 1, GL_FALSE, glm::value_ptr(value));
   }
   void setMat3Uni(const std::string &name, glm::mat3 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniformMatrix3fv(uniLocation, 1, GL_FALSE, glm::value_ptr(value));
   }
   void setMat4Uni(const std::string &name, glm::mat4 &value) const {
-    int uniLocation = glGetUniformLocation(this->programId, name.c_str());
+    int uniLocation = uniformLocation(name);
     checkUniformLocation(uniLocation, name);
     glUniformMatrix4fv(uniLocation, 1, GL_FALSE, glm::value_ptr(value));
   }
   // load shader from file path
   GLuint loadShader(const GLchar *shaderFpath, const char *shdrType);
+  GLuint loadShader(const GLchar *shaderFpath, const char *shdrType,
+                    const std::string &defines);
+  // link the program from the cache or from the sources
+  void buildProgram(const std::vector<ShaderSource> &sources);
+  // fill the resource maps from the linked program
+  void reflect();
+
+private:
+  bool bindBlock(const ShaderResources &blocks, GLenum target,
+                 const std::string &name, GLuint buffer) const;
 };
 
-GLuint Shader::loadShader(const GLchar *shaderFilePath,
-                          const char *shaderType) {
-  // load shader file from system
-  GLuint shader;
-  std::string stype(shaderType);
-  if (stype == "FRAGMENT") {
-    shader = glCreateShader(GL_FRAGMENT_SHADER);
-  } else if (stype == "VERTEX") {
-    shader = glCreateShader(GL_VERTEX_SHADER);
-  } else if (stype == "COMPUTE") {
-    shader = glCreateShader(GL_COMPUTE_SHADER);
-  } else {
-    std::cout << "Unknown shader type:\n" << shaderType << std::endl;
+std::string injectDefines(const std::string &source,
+                          const std::string &defines) {
+  // put defines right after the #version line, glsl wants it first
+  if (defines.empty()) {
+    return source;
   }
+  std::size_t vpos = source.find("#version");
+  if (vpos == std::string::npos) {
+    return defines + source;
+  }
+  std::size_t eol = source.find('\n', vpos);
+  if (eol == std::string::npos) {
+    return source + "\n" + defines;
+  }
+  // line numbers of the errors still match the file
+  int line = 2 + std::count(source.begin(), source.begin() + vpos, '\n');
+  return source.substr(0, eol + 1) + defines + "#line " +
+         std::to_string(line) + " 0\n" + source.substr(eol + 1);
+}
+
+bool readTextFile(const std::filesystem::path &path, std::string &text) {
+  // load shader file from system
   std::ifstream shdrFileStream;
   shdrFileStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  std::string shaderCodeStr;
   try {
-    shdrFileStream.open(shaderFilePath);
+    shdrFileStream.open(path);
     std::stringstream shaderSStream;
     shaderSStream << shdrFileStream.rdbuf();
     shdrFileStream.close();
-    shaderCodeStr = shaderSStream.str();
+    text = shaderSStream.str();
   } catch (std::ifstream::failure e) {
     //
-    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// nested includes deeper than this are taken for a cycle
+const int SHADER_INCLUDE_DEPTH = 16;
+
+std::string expandIncludes(const std::filesystem::path &path,
+                           const std::string &text,
+                           std::vector<std::string> &files, int depth) {
+  // glsl has no includes, every #include "file" line is replaced by the
+  // file, relative to the one including it. Modules carry include guards,
+  // a module included twice is read twice and skipped by the compiler.
+  int fileIndex = static_cast<int>(files.size());
+  files.push_back(path.string());
+  std::istringstream lines(text);
+  std::ostringstream out;
+  std::string line;
+  int lineNb = 0;
+  while (std::getline(lines, line)) {
+    lineNb++;
+    std::size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line.compare(first, 8, "#include") != 0) {
+      out << line << "\n";
+      continue;
+    }
+    std::size_t open = line.find('"', first);
+    std::size_t close = line.find('"', open + 1);
+    if (open == std::string::npos || close == std::string::npos) {
+      std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ":" << lineNb
+                << std::endl;
+      out << "\n";
+      continue;
+    }
+    std::filesystem::path included =
+        path.parent_path() / line.substr(open + 1, close - open - 1);
+    std::string includedText;
+    if (depth >= SHADER_INCLUDE_DEPTH) {
+      std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << included << std::endl;
+    } else if (readTextFile(included, includedText)) {
+      out << "#line 1 " << files.size() << "\n"
+          << expandIncludes(included, includedText, files, depth + 1);
+    }
+    out << "#line " << lineNb + 1 << " " << fileIndex << "\n";
   }
-  const char *shaderCode = shaderCodeStr.c_str();
+  return out.str();
+}
+
+std::string readShaderFile(const GLchar *shaderFilePath,
+                           const std::string &defines,
+                           std::vector<std::string> &files) {
+  // source of a shader with its modules pasted in and the defines of the
+  // variant injected
+  std::string shaderCodeStr;
+  if (!readTextFile(shaderFilePath, shaderCodeStr)) {
+    return "";
+  }
+  shaderCodeStr = expandIncludes(shaderFilePath, shaderCodeStr, files, 0);
+  return injectDefines(shaderCodeStr, defines);
+}
+GLuint compileShader(const ShaderSource &source) {
+  GLuint shader = glCreateShader(source.type);
+  const char *shaderCode = source.code.c_str();
 
   // lets source the shader
   glShaderSource(shader, 1, &shaderCode, NULL);
   glCompileShader(shader);
 
   // a sanity check for unsuccessful compilations
-  checkShaderCompilation(shader, shaderType);
+  if (!checkShaderCompilation(shader, source.typeName) &&
+      source.files.size() > 1) {
+    // errors name the file by its source string number
+    for (std::size_t i = 0; i < source.files.size(); i++) {
+      std::cout << "  " << i << ": " << source.files[i] << std::endl;
+    }
+  }
   return shader;
 }
+ShaderSource shaderSource(const GLchar *shaderFilePath, const char *shaderType,
+                          const std::string &defines) {
+  ShaderSource source;
+  std::string stype(shaderType);
+  if (stype == "FRAGMENT") {
+    source.type = GL_FRAGMENT_SHADER;
+  } else if (stype == "VERTEX") {
+    source.type = GL_VERTEX_SHADER;
+  } else if (stype == "COMPUTE") {
+    source.type = GL_COMPUTE_SHADER;
+  } else {
+    std::cout << "Unknown shader type:\n" << shaderType << std::endl;
+  }
+  source.typeName = shaderType;
+  source.code = readShaderFile(shaderFilePath, defines, source.files);
+  return source;
+}
 
-// first constructor
-Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath) {
-  // loading shaders
+GLuint Shader::loadShader(const GLchar *shaderFilePath,
+                          const char *shaderType) {
+  return this->loadShader(shaderFilePath, shaderType, "");
+}
+GLuint Shader::loadShader(const GLchar *shaderFilePath, const char *shaderType,
+                          const std::string &defines) {
+  return compileShader(shaderSource(shaderFilePath, shaderType, defines));
+}
+
+// ------------------------- program binary cache --------------------------
+std::uint64_t fnv1a(std::uint64_t hash, const std::string &s) {
+  // 64 bit fnv-1a, the terminating zero is hashed too so that the strings
+  // of a key can not run into each other
+  for (std::size_t i = 0; i <= s.size(); i++) {
+    hash ^= static_cast<unsigned char>(s.c_str()[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+std::string glString(GLenum name) {
+  const GLubyte *s = glGetString(name);
+  return s == NULL ? "" : reinterpret_cast<const char *>(s);
+}
+std::filesystem::path programCachePath(
+    const std::vector<ShaderSource> &sources) {
+  // a new driver or any change to the sources gives a new file
+  std::uint64_t hash = 14695981039346656037ull;
+  hash = fnv1a(hash, glString(GL_VENDOR));
+  hash = fnv1a(hash, glString(GL_RENDERER));
+  hash = fnv1a(hash, glString(GL_VERSION));
+  hash = fnv1a(hash, glString(GL_SHADING_LANGUAGE_VERSION));
+  for (const auto &source : sources) {
+    hash = fnv1a(hash, source.typeName);
+    hash = fnv1a(hash, source.code);
+  }
+  std::ostringstream name;
+  name << std::hex << hash << ".bin";
+  return std::filesystem::path(SHADER_CACHE_DIR) / name.str();
+}
+bool programCacheEnabled() {
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return !SHADER_CACHE_DIR.empty() && formats > 0;
+}
+bool loadProgramBinary(GLuint program, const std::filesystem::path &path) {
+  // false when there is no binary or the driver rejects it
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  GLenum format = 0;
+  in.read(reinterpret_cast<char *>(&format), sizeof(format));
+  if (!in) {
+    return false;
+  }
+  std::vector<char> binary((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+  if (binary.empty()) {
+    return false;
+  }
+  glProgramBinary(program, format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success != 0;
+}
+void saveProgramBinary(GLuint program, const std::filesystem::path &path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, NULL, &format, binary.data());
+  std::error_code err;
+  std::filesystem::create_directories(path.parent_path(), err);
+  // written next to the final name first so that a run that dies half way
+  // does not leave a broken binary behind
+  std::filesystem::path tmp = path;
+  tmp += ".tmp";
+  std::ofstream out(tmp, std::ios::binary);
+  if (!out) {
+    return;
+  }
+  out.write(reinterpret_cast<const char *>(&format), sizeof(format));
+  out.write(binary.data(), length);
+  out.close();
+  std::filesystem::rename(tmp, path, err);
+}
+
+void Shader::buildProgram(const std::vector<ShaderSource> &sources) {
+  // try the cached binary first, compile and link when there is none or
+  // the driver rejects it
+  bool cache = programCacheEnabled();
+  std::filesystem::path cachePath;
   this->programId = glCreateProgram();
-  GLuint vshader = this->loadShader(vertexPath, "VERTEX");
-  GLuint fshader = this->loadShader(fragmentPath, "FRAGMENT");
-  glAttachShader(this->programId, vshader);
-  glAttachShader(this->programId, fshader);
+  if (cache) {
+    cachePath = programCachePath(sources);
+    if (loadProgramBinary(this->programId, cachePath)) {
+      this->reflect();
+      return;
+    }
+    // a rejected binary leaves the program unusable
+    glDeleteProgram(this->programId);
+    this->programId = glCreateProgram();
+    glProgramParameteri(this->programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+  std::vector<GLuint> shaders;
+  for (const auto &source : sources) {
+    GLuint shader = compileShader(source);
+    glAttachShader(this->programId, shader);
+    shaders.push_back(shader);
+  }
   glLinkProgram(this->programId);
   checkShaderProgramCompilation(this->programId);
-  glDeleteShader(vshader);
-  glDeleteShader(fshader);
+  for (GLuint shader : shaders) {
+    glDeleteShader(shader);
+  }
+  GLint success = 0;
+  glGetProgramiv(this->programId, GL_LINK_STATUS, &success);
+  if (cache && success != 0) {
+    saveProgramBinary(this->programId, cachePath);
+  }
+  this->reflect();
+}
+
+// ------------------------------ reflection -------------------------------
+std::string resourceName(GLuint program, GLenum interface, GLuint index,
+                         GLint maxLength) {
+  std::vector<char> name(std::max(maxLength, 1), '\0');
+  glGetProgramResourceName(program, interface, index, name.size(), NULL,
+                           name.data());
+  return std::string(name.data());
+}
+void reflectBlocks(GLuint program, GLenum interface,
+                   ShaderResources &blocks) {
+  // binding points of the uniform or storage blocks
+  GLint count = 0;
+  GLint maxLength = 0;
+  glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+  glGetProgramInterfaceiv(program, interface, GL_MAX_NAME_LENGTH, &maxLength);
+  const GLenum props[] = {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+  for (GLint i = 0; i < count; i++) {
+    GLint values[2];
+    glGetProgramResourceiv(program, interface, i, 2, props, 2, NULL, values);
+    blocks[resourceName(program, interface, i, maxLength)] =
+        ShaderResource{values[0], 0, values[1]};
+  }
+}
+void Shader::reflect() {
+  // one pass over the active resources, setters then look locations up
+  // in the maps instead of asking the driver every frame
+  this->uniforms.clear();
+  this->uniformBlocks.clear();
+  this->storageBlocks.clear();
+  GLint linked = 0;
+  glGetProgramiv(this->programId, GL_LINK_STATUS, &linked);
+  if (linked == 0) {
+    return;
+  }
+  GLint count = 0;
+  GLint maxLength = 0;
+  glGetProgramInterfaceiv(this->programId, GL_UNIFORM, GL_ACTIVE_RESOURCES,
+                          &count);
+  glGetProgramInterfaceiv(this->programId, GL_UNIFORM, GL_MAX_NAME_LENGTH,
+                          &maxLength);
+  const GLenum props[] = {GL_BLOCK_INDEX, GL_LOCATION, GL_TYPE,
+                          GL_ARRAY_SIZE};
+  for (GLint i = 0; i < count; i++) {
+    GLint values[4];
+    glGetProgramResourceiv(this->programId, GL_UNIFORM, i, 4, props, 4, NULL,
+                           values);
+    if (values[0] != -1) {
+      // members of uniform blocks are set through their buffer
+      continue;
+    }
+    std::string name =
+        resourceName(this->programId, GL_UNIFORM, i, maxLength);
+    ShaderResource uniform{values[1], static_cast<GLenum>(values[2]),
+                           values[3]};
+    this->uniforms[name] = uniform;
+    // arrays are named "name[0]", the bare name sets the first element
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+      this->uniforms[name.substr(0, name.size() - 3)] = uniform;
+    }
+  }
+  reflectBlocks(this->programId, GL_UNIFORM_BLOCK, this->uniformBlocks);
+  reflectBlocks(this->programId, GL_SHADER_STORAGE_BLOCK,
+                this->storageBlocks);
+}
+bool Shader::bindBlock(const ShaderResources &blocks, GLenum target,
+                       const std::string &name, GLuint buffer) const {
+  auto it = blocks.find(name);
+  if (it == blocks.end()) {
+    std::cout << "Shader program has no block named " << name << std::endl;
+    return false;
+  }
+  glBindBufferBase(target, it->second.location, buffer);
+  return true;
+}
+
+// first constructor
+Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath) {
+  // loading shaders
+  this->buildProgram({shaderSource(vertexPath, "VERTEX", ""),
+                      shaderSource(fragmentPath, "FRAGMENT", "")});
 }
 // third constructor
 Shader::Shader(const GLchar *computePath) {
   // loading shaders
-  this->programId = glCreateProgram();
-  GLuint cshader = this->loadShader(computePath, "COMPUTE");
-  glAttachShader(this->programId, cshader);
-  glLinkProgram(this->programId);
-  checkShaderProgramCompilation(this->programId);
-  glDeleteShader(cshader);
+  this->buildProgram({shaderSource(computePath, "COMPUTE", "")});
+}
+// compute constructor with defines injected into the source
+Shader::Shader(const GLchar *computePath, const std::string &defines) {
+  // loading shaders
+  this->buildProgram({shaderSource(computePath, "COMPUTE", defines)});
 }
 // second constructor
 Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath,
                const GLchar *computePath) {
   // loading shaders
-  this->programId = glCreateProgram();
-  GLuint vshader = this->loadShader(vertexPath, "VERTEX");
-  GLuint fshader = this->loadShader(fragmentPath, "FRAGMENT");
-  GLuint cshader = this->loadShader(computePath, "COMPUTE");
-  glAttachShader(this->programId, vshader);
-  glAttachShader(this->programId, fshader);
-  glAttachShader(this->programId, cshader);
-  glLinkProgram(this->programId);
-  checkShaderProgramCompilation(this->programId);
-  glDeleteShader(vshader);
-  glDeleteShader(fshader);
-  glDeleteShader(cshader);
+  this->buildProgram({shaderSource(vertexPath, "VERTEX", ""),
+                      shaderSource(fragmentPath, "FRAGMENT", ""),
+                      shaderSource(computePath, "COMPUTE", "")});
 }
 
 void Shader::useProgram() { glUseProgram(this->programId); }
@@ -0,0 +1,477 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+// bounding volume hierarchy over the scene objects, built on the host and
+// flattened so that the compute shaders can walk it without a stack
+// license: see LICENSE
+#include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// flattened node, laid out like the std430 BvhNode of the compute shaders.
+// Nodes are stored in depth first order: the left child of an inner node
+// follows it directly, and miss points to the node to visit once the
+// subtree under this node is done or its box is missed, -1 ends the walk.
+struct BvhNode {
+  vec4 bmin; // xyz: box min
+  vec4 bmax; // xyz: box max
+  int left;  // first child of inner nodes, first object of leaves
+  int right; // second child of inner nodes
+  int count; // object count of leaves, 0 for inner nodes
+  int miss;  // next node when the box is missed or the leaf is done
+};
+static_assert(sizeof(BvhNode) == 48, "BvhNode must match std430 layout");
+
+// how a hierarchy came out, to compare builders
+struct BvhStats {
+  double build_ms;
+  float sah_cost; // expected cost of a ray, see BVH_TRAVERSAL_COST
+  int leaves;
+  int depth;
+};
+
+struct Bvh {
+  std::vector<BvhNode> nodes;
+  std::vector<NHittable> objects; // scene objects in leaf order
+  BvhStats stats;
+};
+
+// objects per leaf before a node is split
+int BVH_LEAF_SIZE = 4;
+// the sah builder keeps up to this many objects in a leaf when testing
+// them costs no more than the split, the bvh4 leaf counts take up to 255
+int BVH_MAX_LEAF_SIZE = 16;
+
+// BVH_MEDIAN splits the centers at the median of their longest axis,
+// BVH_SAH picks the split of least surface area cost among BVH_BINS planes
+// per axis, building subtrees on up to BVH_THREADS threads
+enum BvhBuilder { BVH_MEDIAN, BVH_SAH };
+BvhBuilder BVH_BUILDER = BVH_SAH;
+int BVH_BINS = 16; // clamped to 2 .. BVH_MAX_BINS
+const int BVH_MAX_BINS = 64;
+unsigned int BVH_THREADS = 0; // 0: one per hardware thread
+// subtrees with fewer objects stay on the thread that split them
+int BVH_TASK_SIZE = 4096;
+// cost of visiting a node and of testing an object, relative to each other
+float BVH_TRAVERSAL_COST = 1.0f;
+float BVH_INTERSECT_COST = 1.0f;
+
+struct Aabb {
+  vec3 bmin;
+  vec3 bmax;
+};
+Aabb emptyBox() {
+  Aabb box;
+  box.bmin = vec3(INFINITY);
+  box.bmax = vec3(-INFINITY);
+  return box;
+}
+Aabb objectBox(const NHittable &obj) {
+  // bounding box of a sphere
+  vec3 center = vec3(obj.sphere_center);
+  vec3 radius = vec3(std::abs(obj.sphere_radius));
+  Aabb box;
+  box.bmin = center - radius;
+  box.bmax = center + radius;
+  return box;
+}
+Aabb mergeBox(const Aabb &a, const Aabb &b) {
+  Aabb box;
+  box.bmin = glm::min(a.bmin, b.bmin);
+  box.bmax = glm::max(a.bmax, b.bmax);
+  return box;
+}
+
+int buildBvhNode(Bvh &bvh, std::vector<NHittable> &objs, int start, int end) {
+  // build the subtree over objs[start:end], returns its node index
+  Aabb box = emptyBox();
+  Aabb cbox = emptyBox(); // box of the centers, used to pick the split axis
+  for (int i = start; i < end; i++) {
+    box = mergeBox(box, objectBox(objs[i]));
+    vec3 c = vec3(objs[i].sphere_center);
+    cbox.bmin = glm::min(cbox.bmin, c);
+    cbox.bmax = glm::max(cbox.bmax, c);
+  }
+  int index = static_cast<int>(bvh.nodes.size());
+  BvhNode node;
+  node.bmin = vec4(box.bmin, 0);
+  node.bmax = vec4(box.bmax, 0);
+  node.left = start;
+  node.right = -1;
+  node.count = end - start;
+  node.miss = -1;
+  bvh.nodes.push_back(node);
+
+  if (node.count <= BVH_LEAF_SIZE) {
+    return index;
+  }
+  // median split along the longest axis of the centers
+  vec3 extent = cbox.bmax - cbox.bmin;
+  int axis = 0;
+  if (extent.y > extent.x) {
+    axis = 1;
+  }
+  if (extent.z > extent[axis]) {
+    axis = 2;
+  }
+  int mid = start + (end - start) / 2;
+  std::nth_element(objs.begin() + start, objs.begin() + mid,
+                   objs.begin() + end,
+                   [axis](const NHittable &a, const NHittable &b) {
+                     return a.sphere_center[axis] < b.sphere_center[axis];
+                   });
+  int left = buildBvhNode(bvh, objs, start, mid);
+  int right = buildBvhNode(bvh, objs, mid, end);
+  bvh.nodes[index].left = left;
+  bvh.nodes[index].right = right;
+  bvh.nodes[index].count = 0;
+  return index;
+}
+float boxArea(const Aabb &box) {
+  vec3 d = glm::max(box.bmax - box.bmin, vec3(0));
+  return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// object of the sah build, the objects are only moved once it is done
+struct BvhPrim {
+  vec3 center;
+  float radius; // absolute radius
+  int index;    // into the scene
+};
+// node of the sah build, the children of a node are allocated together
+struct BvhBuildNode {
+  Aabb box;
+  int child; // first of the two children, -1 for leaves
+  int start; // first prim of the subtree
+  int count;
+};
+// nodes of every thread in one block, 2n - 1 nodes at most for n objects
+struct BvhArena {
+  std::vector<BvhBuildNode> nodes;
+  std::atomic<int> next;
+  int bins; // BVH_BINS clamped to the bin arrays
+};
+
+struct BvhBin {
+  Aabb box;
+  int count;
+};
+// the bins of the three axes, one set per thread when a node is binned in
+// chunks
+struct BvhBins {
+  BvhBin bins[3][BVH_MAX_BINS];
+};
+
+template <typename F>
+void forChunks(int start, int end, unsigned int threads, F f) {
+  // f(chunk, begin, end) over threads chunks of [start, end) side by side,
+  // the calling thread takes the first one
+  int size = (end - start + static_cast<int>(threads) - 1) / threads;
+  std::vector<std::thread> workers;
+  for (unsigned int c = 1; c < threads; c++) {
+    int begin = std::min(start + static_cast<int>(c) * size, end);
+    workers.emplace_back(f, c, begin, std::min(begin + size, end));
+  }
+  f(0u, start, std::min(start + size, end));
+  for (std::thread &w : workers) {
+    w.join();
+  }
+}
+
+int binIndex(float center, float cmin, float scale, int bins) {
+  return std::min(int((center - cmin) * scale), bins - 1);
+}
+void binPrims(const std::vector<BvhPrim> &prims, int start, int end,
+              const Aabb &cbox, vec3 scale, int bin_count, BvhBins &b) {
+  // add prims[start:end] to the bins of all three axes
+  for (int a = 0; a < 3; a++) {
+    for (int k = 0; k < bin_count; k++) {
+      b.bins[a][k].box = emptyBox();
+      b.bins[a][k].count = 0;
+    }
+  }
+  for (int i = start; i < end; i++) {
+    const BvhPrim &p = prims[i];
+    vec3 lo = p.center - p.radius;
+    vec3 hi = p.center + p.radius;
+    for (int a = 0; a < 3; a++) {
+      BvhBin &bin =
+          b.bins[a][binIndex(p.center[a], cbox.bmin[a], scale[a], bin_count)];
+      bin.count++;
+      bin.box.bmin = glm::min(bin.box.bmin, lo);
+      bin.box.bmax = glm::max(bin.box.bmax, hi);
+    }
+  }
+}
+float sahSplit(const std::vector<BvhPrim> &prims, int start, int end,
+               const Aabb &box, const Aabb &cbox, int bin_count,
+               unsigned int threads, int &axis, int &split) {
+  // cost of the cheapest split, in the units of bvhStats before the
+  // division by the root area, INFINITY when the centers cannot be told
+  // apart. split is the bin the right side starts at along axis. Large
+  // nodes are binned in chunks on threads, the bins are merged after.
+  vec3 extent = cbox.bmax - cbox.bmin;
+  vec3 scale;
+  for (int a = 0; a < 3; a++) {
+    scale[a] = extent[a] > 0 ? bin_count / extent[a] : 0;
+  }
+  std::vector<BvhBins> chunks(threads);
+  forChunks(start, end, threads,
+            [&](unsigned int c, int begin, int chunk_end) {
+              binPrims(prims, begin, chunk_end, cbox, scale, bin_count,
+                       chunks[c]);
+            });
+  BvhBins &merged = chunks[0];
+  for (unsigned int c = 1; c < threads; c++) {
+    for (int a = 0; a < 3; a++) {
+      for (int k = 0; k < bin_count; k++) {
+        BvhBin &bin = merged.bins[a][k];
+        bin.box = mergeBox(bin.box, chunks[c].bins[a][k].box);
+        bin.count += chunks[c].bins[a][k].count;
+      }
+    }
+  }
+
+  float best = INFINITY;
+  split = 0;
+  float right_cost[BVH_MAX_BINS];
+  int right_count[BVH_MAX_BINS];
+  for (int a = 0; a < 3; a++) {
+    if (extent[a] <= 0) {
+      continue;
+    }
+    const BvhBin *bins = merged.bins[a];
+    // sweep from the right, then from the left over the split planes
+    Aabb side = emptyBox();
+    int count = 0;
+    for (int b = bin_count - 1; b > 0; b--) {
+      side = mergeBox(side, bins[b].box);
+      count += bins[b].count;
+      right_cost[b] = boxArea(side) * count;
+      right_count[b] = count;
+    }
+    side = emptyBox();
+    count = 0;
+    for (int b = 1; b < bin_count; b++) {
+      side = mergeBox(side, bins[b - 1].box);
+      count += bins[b - 1].count;
+      if (count == 0 || right_count[b] == 0) {
+        continue;
+      }
+      float cost = boxArea(side) * count + right_cost[b];
+      if (cost < best) {
+        best = cost;
+        split = b;
+        axis = a;
+      }
+    }
+  }
+  // the children are taken for leaves, deeper splits only lower the cost
+  return BVH_TRAVERSAL_COST * boxArea(box) + BVH_INTERSECT_COST * best;
+}
+void buildSahNode(BvhArena &arena, std::vector<BvhPrim> &prims, int index,
+                  int start, int end, unsigned int threads) {
+  // fill arena node index with the subtree over prims[start:end], the two
+  // halves are built side by side while there are threads to share, and
+  // the nodes above them bound and bin their objects in chunks
+  unsigned int chunks = end - start > BVH_TASK_SIZE ? threads : 1;
+  std::vector<Aabb> boxes(chunks), cboxes(chunks);
+  forChunks(start, end, chunks, [&](unsigned int c, int begin, int chunk_end) {
+    Aabb box = emptyBox();
+    Aabb cbox = emptyBox();
+    for (int i = begin; i < chunk_end; i++) {
+      const BvhPrim &p = prims[i];
+      box.bmin = glm::min(box.bmin, p.center - p.radius);
+      box.bmax = glm::max(box.bmax, p.center + p.radius);
+      cbox.bmin = glm::min(cbox.bmin, p.center);
+      cbox.bmax = glm::max(cbox.bmax, p.center);
+    }
+    boxes[c] = box;
+    cboxes[c] = cbox;
+  });
+  Aabb box = boxes[0];
+  Aabb cbox = cboxes[0];
+  for (unsigned int c = 1; c < chunks; c++) {
+    box = mergeBox(box, boxes[c]);
+    cbox = mergeBox(cbox, cboxes[c]);
+  }
+  BvhBuildNode &node = arena.nodes[index];
+  node.box = box;
+  node.child = -1;
+  node.start = start;
+  node.count = end - start;
+  if (node.count <= BVH_LEAF_SIZE) {
+    return;
+  }
+  int axis = 0;
+  int split = 0;
+  int bins = arena.bins;
+  float cost =
+      sahSplit(prims, start, end, box, cbox, bins, chunks, axis, split);
+  if (node.count <= BVH_MAX_LEAF_SIZE &&
+      cost >= BVH_INTERSECT_COST * node.count * boxArea(box)) {
+    // testing the objects is as cheap as splitting them
+    return;
+  }
+  int mid = start + (end - start) / 2;
+  if (split > 0) {
+    float scale = bins / (cbox.bmax[axis] - cbox.bmin[axis]);
+    float cmin = cbox.bmin[axis];
+    auto right = std::partition(
+        prims.begin() + start, prims.begin() + end,
+        [axis, scale, cmin, split, bins](const BvhPrim &p) {
+          return binIndex(p.center[axis], cmin, scale, bins) < split;
+        });
+    mid = static_cast<int>(right - prims.begin());
+  }
+  if (mid == start || mid == end) {
+    // every center falls on one side, halve the objects as they lie
+    mid = start + (end - start) / 2;
+  }
+  int child = arena.next.fetch_add(2);
+  node.child = child;
+  if (threads > 1 && end - start > BVH_TASK_SIZE) {
+    std::thread left(buildSahNode, std::ref(arena), std::ref(prims), child,
+                     start, mid, threads / 2);
+    buildSahNode(arena, prims, child + 1, mid, end, threads - threads / 2);
+    left.join();
+    return;
+  }
+  buildSahNode(arena, prims, child, start, mid, 1);
+  buildSahNode(arena, prims, child + 1, mid, end, 1);
+}
+int flattenNode(Bvh &bvh, const BvhArena &arena, int index) {
+  // copy the subtree into bvh.nodes in depth first order
+  const BvhBuildNode &b = arena.nodes[index];
+  int flat = static_cast<int>(bvh.nodes.size());
+  BvhNode node;
+  node.bmin = vec4(b.box.bmin, 0);
+  node.bmax = vec4(b.box.bmax, 0);
+  node.left = b.start;
+  node.right = -1;
+  node.count = b.count;
+  node.miss = -1;
+  bvh.nodes.push_back(node);
+  if (b.child == -1) {
+    return flat;
+  }
+  int left = flattenNode(bvh, arena, b.child);
+  int right = flattenNode(bvh, arena, b.child + 1);
+  bvh.nodes[flat].left = left;
+  bvh.nodes[flat].right = right;
+  bvh.nodes[flat].count = 0;
+  return flat;
+}
+void buildSahBvh(Bvh &bvh, const std::vector<NHittable> &scene) {
+  int n = static_cast<int>(scene.size());
+  std::vector<BvhPrim> prims(n);
+  for (int i = 0; i < n; i++) {
+    prims[i].center = vec3(scene[i].sphere_center);
+    prims[i].radius = std::abs(scene[i].sphere_radius);
+    prims[i].index = i;
+  }
+  BvhArena arena;
+  arena.nodes.resize(2 * n - 1);
+  arena.next = 1;
+  // the bins live in fixed arrays on the stack of every node
+  arena.bins = std::clamp(BVH_BINS, 2, BVH_MAX_BINS);
+  unsigned int threads = BVH_THREADS;
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  buildSahNode(arena, prims, 0, 0, n, threads);
+  bvh.nodes.reserve(arena.next);
+  flattenNode(bvh, arena, 0);
+  // leaves hold their objects in prim order
+  bvh.objects.resize(n);
+  for (int i = 0; i < n; i++) {
+    bvh.objects[i] = scene[prims[i].index];
+  }
+}
+
+int statsNode(const Bvh &bvh, int node, float root_area, BvhStats &stats) {
+  // adds the subtree to the cost and the leaf count, returns its depth
+  const BvhNode &n = bvh.nodes[node];
+  Aabb box;
+  box.bmin = vec3(n.bmin);
+  box.bmax = vec3(n.bmax);
+  float area = boxArea(box) / root_area;
+  if (n.count > 0) {
+    stats.sah_cost += BVH_INTERSECT_COST * n.count * area;
+    stats.leaves++;
+    return 1;
+  }
+  stats.sah_cost += BVH_TRAVERSAL_COST * area;
+  return 1 + std::max(statsNode(bvh, n.left, root_area, stats),
+                      statsNode(bvh, n.right, root_area, stats));
+}
+BvhStats bvhStats(const Bvh &bvh, double build_ms) {
+  // surface area cost: nodes and objects weighted by the chance that a ray
+  // through the root box goes through their box too
+  BvhStats stats;
+  stats.build_ms = build_ms;
+  stats.sah_cost = 0;
+  stats.leaves = 0;
+  stats.depth = 0;
+  Aabb root;
+  root.bmin = vec3(bvh.nodes[0].bmin);
+  root.bmax = vec3(bvh.nodes[0].bmax);
+  float root_area = boxArea(root);
+  if (bvh.objects.empty() || root_area <= 0) {
+    return stats;
+  }
+  stats.depth = statsNode(bvh, 0, root_area, stats);
+  return stats;
+}
+
+void linkMiss(Bvh &bvh, int node, int miss) {
+  // where to go once this subtree is done: the right sibling for a left
+  // child, the parent's miss link for a right child
+  bvh.nodes[node].miss = miss;
+  if (bvh.nodes[node].count == 0) {
+    int right = bvh.nodes[node].right;
+    linkMiss(bvh, bvh.nodes[node].left, right);
+    linkMiss(bvh, right, miss);
+  }
+}
+
+Bvh buildBvh(const std::vector<NHittable> &scene) {
+  // build and flatten the hierarchy, objects are reordered into leaf order
+  Bvh bvh;
+  bvh.objects = scene;
+  if (bvh.objects.empty()) {
+    // an inner root without children, the walk ends right after it
+    BvhNode root;
+    root.bmin = vec4(0);
+    root.bmax = vec4(0);
+    root.left = -1;
+    root.right = -1;
+    root.count = 0;
+    root.miss = -1;
+    bvh.nodes.push_back(root);
+    bvh.stats = bvhStats(bvh, 0);
+    return bvh;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (BVH_BUILDER == BVH_SAH) {
+    buildSahBvh(bvh, scene);
+  } else {
+    bvh.nodes.reserve(2 * bvh.objects.size() / BVH_LEAF_SIZE + 1);
+    buildBvhNode(bvh, bvh.objects, 0, static_cast<int>(bvh.objects.size()));
+  }
+  linkMiss(bvh, 0, -1);
+  bvh.stats = bvhStats(bvh, std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+  std::cout << "bvh " << (BVH_BUILDER == BVH_SAH ? "sah" : "median")
+            << " build: " << bvh.stats.build_ms << " ms, "
+            << bvh.nodes.size() << " nodes, " << bvh.stats.leaves
+            << " leaves, depth " << bvh.stats.depth << ", sah cost "
+            << bvh.stats.sah_cost << std::endl;
+  return bvh;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef BVH4_HPP
+#define BVH4_HPP
+// four wide bvh with quantized child boxes, collapsed from the binary one.
+// A node stores the boxes of its four children relative to its own box in
+// BVH4_BITS bits per bound, the kernels test all four at once with vec4
+// math and fetch one small node where the binary walk fetches up to three
+// larger ones.
+// license: see LICENSE
+#include "bvh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// walk the four wide bvh in the kernels of lib/hittable.glsl instead of
+// the binary one. The early kernels with their own walk, compute01 to
+// compute03, only know the binary layout, and the GPU_BVH build stays
+// binary.
+bool BVH_WIDE = false;
+// bits of a quantized bound, 8 or 16
+int BVH4_BITS = 8;
+
+// a node in uvec4 vectors of the std430 Bvh4Buffer:
+//  0: xyz the float bits of the node box min, w the scale exponents of the
+//     axes, a signed byte each
+//  1: xyz the lower child bounds of the axes, w the object count of leaf
+//     children, a byte each, 0 for inner children
+//  2: xyz the upper child bounds, w unused
+//  3: the children: a node for inner children, the first object for
+//     leaves, -1 for an empty slot
+// with 8 bits a bound word holds a byte per child. With 16 bits vectors 1
+// and 2 hold the bounds of children 0 and 1, vectors 3 and 4 those of
+// children 2 and 3, and the children move to vector 5.
+struct Bvh4 {
+  std::vector<uint32_t> words;
+  int node_count;
+  int stack_size; // deepest stack of the walk
+};
+
+int bvh4Vectors(int bits) { return bits == 16 ? 6 : 4; }
+
+uint32_t floatWord(float x) {
+  uint32_t u;
+  std::memcpy(&u, &x, sizeof(u));
+  return u;
+}
+
+Aabb nodeBox(const BvhNode &n) {
+  Aabb box;
+  box.bmin = vec3(n.bmin);
+  box.bmax = vec3(n.bmax);
+  return box;
+}
+
+int quantExponent(float origin, float extent, float bmax, int qmax) {
+  // smallest power of two step that covers the box in qmax steps, the
+  // kernels compute origin + q * 2^e in floats the same way
+  int e = -126;
+  if (extent > 0) {
+    e = std::max(static_cast<int>(std::ceil(std::log2(extent / qmax))), -126);
+  }
+  while (origin + qmax * std::ldexp(1.0f, e) < bmax) {
+    e++;
+  }
+  return std::min(e, 127);
+}
+uint32_t quantLow(float origin, float scale, float bound, int qmax) {
+  // rounded down, the dequantized bound stays below the real one
+  int q = std::clamp(static_cast<int>(std::floor((bound - origin) / scale)), 0,
+                     qmax);
+  while (q > 0 && origin + q * scale > bound) {
+    q--;
+  }
+  return q;
+}
+uint32_t quantHigh(float origin, float scale, float bound, int qmax) {
+  int q = std::clamp(static_cast<int>(std::ceil((bound - origin) / scale)), 0,
+                     qmax);
+  while (q < qmax && origin + q * scale < bound) {
+    q++;
+  }
+  return q;
+}
+
+int collapseNode(Bvh4 &wide, const Bvh &bvh, std::vector<int> children,
+                 int &stack) {
+  // one wide node over up to four binary subtrees, opening the inner child
+  // of largest area until there are four. Returns its index, stack is the
+  // walk's stack under it.
+  while (children.size() < 4) {
+    int open = -1;
+    float area = -1;
+    for (size_t k = 0; k < children.size(); k++) {
+      const BvhNode &n = bvh.nodes[children[k]];
+      if (n.count == 0 && boxArea(nodeBox(n)) > area) {
+        area = boxArea(nodeBox(n));
+        open = static_cast<int>(k);
+      }
+    }
+    if (open == -1) {
+      break;
+    }
+    const BvhNode &n = bvh.nodes[children[open]];
+    children[open] = n.left;
+    children.push_back(n.right);
+  }
+  int vectors = bvh4Vectors(BVH4_BITS);
+  int index = wide.node_count++;
+  wide.words.resize(wide.node_count * vectors * 4, 0);
+
+  // the inner children are collapsed first, their indices go into this node
+  int slots[4] = {-1, -1, -1, -1};
+  uint32_t counts[4] = {0, 0, 0, 0};
+  int inner = 0;
+  int deepest = 0;
+  Aabb box = emptyBox();
+  for (size_t k = 0; k < children.size(); k++) {
+    const BvhNode &n = bvh.nodes[children[k]];
+    box = mergeBox(box, nodeBox(n));
+    if (n.count > 0) {
+      // leaves hold at most BVH_MAX_LEAF_SIZE objects, up to 255 fit
+      slots[k] = n.left;
+      counts[k] = n.count;
+      continue;
+    }
+    int child_stack = 0;
+    slots[k] = collapseNode(wide, bvh, {n.left, n.right}, child_stack);
+    deepest = std::max(deepest, child_stack);
+    inner++;
+  }
+  // all inner children are pushed, the walk goes on with one of them
+  stack = inner == 0 ? 0 : std::max(inner, inner - 1 + deepest);
+
+  uint32_t *w = &wide.words[index * vectors * 4];
+  int qmax = (1 << BVH4_BITS) - 1;
+  uint32_t exponents = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    float origin = children.empty() ? 0 : box.bmin[axis];
+    float extent = children.empty() ? 0 : box.bmax[axis] - box.bmin[axis];
+    int e = quantExponent(origin, extent, origin + extent, qmax);
+    float scale = std::ldexp(1.0f, e);
+    w[axis] = floatWord(origin);
+    exponents |= (static_cast<uint32_t>(e) & 0xffu) << (8 * axis);
+    for (size_t k = 0; k < children.size(); k++) {
+      Aabb cbox = nodeBox(bvh.nodes[children[k]]);
+      uint32_t lo = quantLow(origin, scale, cbox.bmin[axis], qmax);
+      uint32_t hi = quantHigh(origin, scale, cbox.bmax[axis], qmax);
+      if (BVH4_BITS == 16) {
+        // children 0 and 1 in vectors 1 and 2, 2 and 3 in vectors 3 and 4
+        int word = 4 + (k / 2) * 8 + axis;
+        w[word] |= lo << (16 * (k % 2));
+        w[word + 4] |= hi << (16 * (k % 2));
+      } else {
+        w[4 + axis] |= lo << (8 * k);
+        w[8 + axis] |= hi << (8 * k);
+      }
+    }
+  }
+  w[3] = exponents;
+  for (int k = 0; k < 4; k++) {
+    w[7] |= counts[k] << (8 * k);
+    w[(vectors - 1) * 4 + k] = static_cast<uint32_t>(slots[k]);
+  }
+  return index;
+}
+
+Bvh4 collapseBvh(const Bvh &bvh) {
+  // the root of the wide tree opens the binary root, a leaf root becomes
+  // its only child and the inner root of an empty scene has none
+  Bvh4 wide;
+  wide.node_count = 0;
+  wide.stack_size = 0;
+  const BvhNode &root = bvh.nodes[0];
+  std::vector<int> children;
+  if (root.count > 0) {
+    children.push_back(0);
+  } else if (root.left != -1) {
+    children = {root.left, root.right};
+  }
+  collapseNode(wide, bvh, children, wide.stack_size);
+  // the kernels declare the stack as an array, it needs an element
+  wide.stack_size = std::max(wide.stack_size, 1);
+  std::cout << "bvh4 " << BVH4_BITS << " bit: " << wide.node_count
+            << " nodes, " << wide.words.size() * 4 / 1024 << " KB against "
+            << bvh.nodes.size() * sizeof(BvhNode) / 1024
+            << " KB binary, stack " << wide.stack_size << std::endl;
+  return wide;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
+// camera and frame parameters of the kernels, computed once on the host and
+// read by every invocation from the std140 RenderParams uniform block
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <custom/shader.hpp>
+//
+#include "utils.hpp"
+//
+#include <cstring>
+
+// layout of the std140 RenderParams block of shaders/lib/params.glsl
+struct RenderParams {
+  glm::vec4 origin;     // xyz: camera origin, w: lens radius
+  glm::vec4 lower_left; // xyz: lower left corner of the focus plane
+  glm::vec4 horizontal; // xyz: width of the focus plane
+  glm::vec4 vertical;   // xyz: height of the focus plane
+  glm::vec4 u;          // xyz: camera basis
+  glm::vec4 v;
+  glm::vec4 w;
+  glm::vec2 shutter;    // open and close times
+  GLint max_depth;      // bounces of a path, 0 keeps the kernel's MAX_DEPTH
+  GLint frame_samples;  // samples added by the dispatch, 0 uses psample
+  GLint frame_index;    // frames accumulated so far, 0 restarts the sum
+  GLint preview_step;   // 1 renders every pixel, n one pixel per n x n block
+  GLint pad[2];
+};
+static_assert(sizeof(RenderParams) == 144, "std140 layout of RenderParams");
+
+struct RenderBlock {
+  GLuint ubo;
+  RenderParams params; // what the buffer holds
+  bool uploaded;
+  unsigned int uploads; // buffer updates so far
+};
+
+RenderParams cameraParams(const CameraSettings &cs, unsigned int w,
+                          unsigned int h) {
+  // camera part of the block, the frame fields are left at 0
+  RayCameraLens cam =
+      makeCamera(cs.pos, cs.target, cs.up, cs.vfov, float(w) / float(h),
+                 cs.aperture, cs.focus_dist, cs.t0, cs.t1);
+  RenderParams p;
+  std::memset(&p, 0, sizeof(p));
+  p.origin = glm::vec4(cam.origin, cam.lens_radius);
+  p.lower_left = glm::vec4(cam.lower_left_corner, 0);
+  p.horizontal = glm::vec4(cam.horizontal, 0);
+  p.vertical = glm::vec4(cam.vertical, 0);
+  p.u = glm::vec4(cam.u, 0);
+  p.v = glm::vec4(cam.v, 0);
+  p.w = glm::vec4(cam.w, 0);
+  p.shutter = glm::vec2(cam.time0, cam.time1);
+  return p;
+}
+
+RenderBlock makeRenderBlock() {
+  RenderBlock rb;
+  glGenBuffers(1, &rb.ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, rb.ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(RenderParams), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  std::memset(&rb.params, 0, sizeof(rb.params));
+  rb.uploaded = false;
+  rb.uploads = 0;
+  return rb;
+}
+void updateRenderBlock(RenderBlock &rb, const RenderParams &params) {
+  // the buffer is only written when a field changed
+  if (rb.uploaded && std::memcmp(&rb.params, &params, sizeof(params)) == 0) {
+    return;
+  }
+  rb.params = params;
+  rb.uploaded = true;
+  rb.uploads++;
+  glBindBuffer(GL_UNIFORM_BUFFER, rb.ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(params), &params);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+void bindRenderBlock(const Shader &shader, const RenderBlock &rb) {
+  // kernels that still build their camera per pixel have no block
+  if (shader.hasUniformBlock("RenderParams")) {
+    shader.bindUniformBlock("RenderParams", rb.ubo);
+  }
+}
+void deleteRenderBlock(RenderBlock &rb) { glDeleteBuffers(1, &rb.ubo); }
+
+#endif
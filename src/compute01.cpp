@@ -2,4 +2,6 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader 01 Window", "compute01.comp"); }
+int main() {
+  return launch("Compute Shader 01 Window", "compute01.comp", twoSphereScene());
+}
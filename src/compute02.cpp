@@ -2,4 +2,6 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader 02 Window", "compute02.comp"); }
+int main() {
+  return launch("Compute Shader 02 Window", "compute02.comp", twoSphereScene());
+}
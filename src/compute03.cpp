@@ -2,4 +2,6 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader 03 Window", "compute03.comp"); }
+int main() {
+  return launch("Compute Shader 03 Window", "compute03.comp", twoSphereScene());
+}
@@ -2,4 +2,6 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader 04 Window", "compute04.comp"); }
+int main() {
+  return launch("Compute Shader 04 Window", "compute04.comp", checkeredScene());
+}
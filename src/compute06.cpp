@@ -2,4 +2,7 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader 06 Window", "compute06.comp"); }
+int main() {
+  CAMERA.focus_dist = 5;
+  return launch("Compute Shader 06 Window", "compute06.comp", perlinScene());
+}
@@ -0,0 +1,118 @@
+#ifndef CONTROLS_HPP
+#define CONTROLS_HPP
+// fly camera of the windowed render loops: W A S D move, space and left
+// shift go up and down, dragging with the left mouse button looks around
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <GLFW/glfw3.h>
+//
+#include "camera.hpp"
+//
+#include <glm/gtc/quaternion.hpp>
+//
+#include <algorithm>
+#include <cmath>
+
+float CAMERA_SPEED = 4.0f; // scene units per second
+float CAMERA_TURN = 0.2f;  // degrees per pixel of mouse motion
+
+struct CameraControls {
+  double last_time; // glfwGetTime of the last update
+  double cursor_x;  // cursor position of the last update while dragging
+  double cursor_y;
+  bool dragging;
+};
+
+CameraControls makeControls() {
+  CameraControls cc;
+  cc.last_time = glfwGetTime();
+  cc.cursor_x = 0;
+  cc.cursor_y = 0;
+  cc.dragging = false;
+  return cc;
+}
+
+bool turnCamera(CameraSettings &cs, float yaw, float pitch) {
+  // yaw turns around the up vector, pitch around the right vector, the
+  // target keeps its distance and the view never flips over the up vector
+  vec3 view = cs.target - cs.pos;
+  float dist = glm::length(view);
+  vec3 forward = view / dist;
+  vec3 right = glm::normalize(glm::cross(forward, cs.up));
+  glm::quat turn =
+      glm::angleAxis(degree_to_radian(-yaw), glm::normalize(cs.up)) *
+      glm::angleAxis(degree_to_radian(-pitch), right);
+  vec3 turned = glm::normalize(turn * forward);
+  if (std::abs(glm::dot(turned, glm::normalize(cs.up))) > 0.99f) {
+    // only keep the yaw when looking straight up or down
+    turned = glm::normalize(
+        glm::angleAxis(degree_to_radian(-yaw), glm::normalize(cs.up)) *
+        forward);
+  }
+  if (turned == forward) {
+    return false;
+  }
+  cs.target = cs.pos + turned * dist;
+  return true;
+}
+
+bool moveCamera(CameraControls &cc, GLFWwindow *window, CameraSettings &cs) {
+  // apply the keys and the mouse drag since the last update to the camera,
+  // true when it moved
+  double now = glfwGetTime();
+  // a long stall should not throw the camera across the scene
+  float dt = std::min(static_cast<float>(now - cc.last_time), 0.1f);
+  cc.last_time = now;
+
+  vec3 forward = glm::normalize(cs.target - cs.pos);
+  vec3 right = glm::normalize(glm::cross(forward, cs.up));
+  vec3 up = glm::normalize(cs.up);
+  vec3 step(0);
+  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    step += forward;
+  }
+  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    step -= forward;
+  }
+  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    step += right;
+  }
+  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    step -= right;
+  }
+  if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+    step += up;
+  }
+  if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+    step -= up;
+  }
+  bool moved = false;
+  if (step != vec3(0)) {
+    // target moves along, the focus distance stays the same
+    step = glm::normalize(step) * CAMERA_SPEED * dt;
+    cs.pos += step;
+    cs.target += step;
+    moved = true;
+  }
+
+  if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) != GLFW_PRESS) {
+    cc.dragging = false;
+    return moved;
+  }
+  double x, y;
+  glfwGetCursorPos(window, &x, &y);
+  if (cc.dragging) {
+    float yaw = static_cast<float>(x - cc.cursor_x) * CAMERA_TURN;
+    float pitch = static_cast<float>(y - cc.cursor_y) * CAMERA_TURN;
+    if (yaw != 0 || pitch != 0) {
+      moved = turnCamera(cs, yaw, pitch) || moved;
+    }
+  }
+  cc.cursor_x = x;
+  cc.cursor_y = y;
+  cc.dragging = true;
+  return moved;
+}
+
+#endif
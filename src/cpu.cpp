@@ -0,0 +1,8 @@
+// weekend scene on the cpu, a reference for the images of weekend.out
+// license: see LICENSE
+#include "cpu.hpp"
+
+int main() {
+  CAMERA = weekendCamera();
+  return renderCpu(randomScene());
+}
@@ -0,0 +1,540 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+// reference renderer on the cpu: the integrator of weekend.comp over the same
+// bvh and owen scrambled sobol sampler, run by a pool of threads that steal
+// image tiles from each other. No gl context is needed, the image goes
+// through the same ppm writer as the headless gpu runs.
+// license: see LICENSE
+#include "bvh.hpp"
+#include "packet.hpp"
+#include "ppm.hpp"
+#include "sampler.hpp"
+#include "scene.hpp"
+#include "utils.hpp"
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// image size and samples per pixel of a cpu render, the CPU_SAMPLES,
+// CPU_THREADS and CPU_OUTPUT environment variables set them
+unsigned int CPU_WIDTH = 384; // WINWIDTH and WINHEIGHT of window.hpp
+unsigned int CPU_HEIGHT = 216;
+int CPU_SAMPLES = 64;
+unsigned int CPU_THREADS = 0; // 0: one per hardware thread
+std::string CPU_OUTPUT = "cpu.ppm";
+// edge of the square tiles in pixels, a tile is one task of the pool
+unsigned int CPU_TILE = 16;
+// same as MAX_DEPTH of weekend.comp and ROULETTE_DEPTH of window.hpp
+int CPU_MAX_DEPTH = 50;
+int CPU_ROULETTE_DEPTH = 3;
+
+void cpuFromEnv() {
+  const char *samples = std::getenv("CPU_SAMPLES");
+#ifdef PACKET_SIMD
+  const char *packets = std::getenv("CPU_PACKETS");
+  if (packets != NULL) {
+    CPU_PACKETS = std::atoi(packets) != 0;
+  }
+#endif
+  const char *threads = std::getenv("CPU_THREADS");
+  const char *output = std::getenv("CPU_OUTPUT");
+  if (samples != NULL) {
+    CPU_SAMPLES = std::max(std::atoi(samples), 1);
+  }
+  if (threads != NULL) {
+    CPU_THREADS = std::atoi(threads);
+  }
+  if (output != NULL) {
+    CPU_OUTPUT = output;
+  }
+}
+
+// ------------------ sampler, see shaders/lib/sampler.glsl -----------------
+
+uint32_t pcg_hash(uint32_t v) {
+  uint32_t state = v * 747796405u + 2891336453u;
+  uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+uint32_t reverse_bits(uint32_t x) {
+  // bitfieldReverse of glsl
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+uint32_t laine_karras(uint32_t x, uint32_t seed) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+  return reverse_bits(laine_karras(reverse_bits(x), seed));
+}
+
+struct CpuSampler {
+  const GLuint *directions; // sobolDirections table
+  uint32_t index;
+  uint32_t seed;
+  int dim;
+};
+CpuSampler makeSampler(const std::vector<GLuint> &directions, int px, int py,
+                       int sample_index) {
+  CpuSampler s;
+  s.directions = directions.data();
+  s.seed = pcg_hash(pcg_hash(uint32_t(px)) ^ uint32_t(py));
+  s.index = owen_scramble(uint32_t(sample_index), s.seed);
+  s.dim = 0;
+  return s;
+}
+uint32_t sobol(const CpuSampler &s) {
+  uint32_t x = 0;
+  const GLuint *dv = s.directions + (s.dim % SOBOL_DIMS) * SOBOL_BITS;
+  uint32_t index = s.index;
+  for (int bit = 0; index != 0; bit++) {
+    if (index & 1u) {
+      x ^= dv[bit];
+    }
+    index >>= 1;
+  }
+  return x;
+}
+float sample_1d(CpuSampler &s) {
+  // as in lib/sampler.glsl, every wrap of the table shuffles the index
+  uint32_t wrap = uint32_t(s.dim / SOBOL_DIMS);
+  CpuSampler w = s;
+  if (wrap != 0) {
+    w.index = owen_scramble(s.index, pcg_hash(s.seed ^ wrap));
+  }
+  uint32_t x = owen_scramble(sobol(w), pcg_hash(s.seed ^ uint32_t(s.dim)));
+  s.dim++;
+  return float(x >> 8) / 16777216.0f;
+}
+vec2 sample_2d(CpuSampler &s) {
+  float x = sample_1d(s);
+  float y = sample_1d(s);
+  return vec2(x, y);
+}
+void start_bounce(CpuSampler &s, int bounce) { s.dim = 4 + 4 * bounce; }
+float roulette_sample(CpuSampler s, int bounce) {
+  s.dim = 4 + 4 * bounce + 3;
+  return sample_1d(s);
+}
+vec3 random_in_unit_sphere(CpuSampler &smp) {
+  vec2 uv = sample_2d(smp);
+  vec3 u = vec3(uv, sample_1d(smp));
+  float z = 1 - 2 * u.x;
+  float r = std::sqrt(std::max(0.0f, 1 - z * z));
+  float a = 2 * PI * u.y;
+  return std::pow(u.z, 1.0f / 3.0f) *
+         vec3(r * std::cos(a), r * std::sin(a), z);
+}
+vec3 random_in_hemisphere(vec3 normal, CpuSampler &smp) {
+  vec3 unit_sphere_dir = random_in_unit_sphere(smp);
+  if (glm::dot(unit_sphere_dir, normal) > 0.0f) {
+    return unit_sphere_dir;
+  }
+  return -1.0f * unit_sphere_dir;
+}
+vec3 random_in_unit_disk(CpuSampler &smp) {
+  vec2 u = sample_2d(smp);
+  float r = std::sqrt(u.x);
+  float a = 2 * PI * u.y;
+  return vec3(r * std::cos(a), r * std::sin(a), 0);
+}
+
+// ------------- bvh walk, see shaders/lib/hittable.glsl --------------------
+
+struct CpuHit {
+  vec3 point;
+  vec3 normal;
+  float dist;
+  bool front_face;
+  int obj_index; // index into Bvh::objects
+};
+
+void setSphereRecord(const NHittable &obj, const Ray &r, float margin,
+                     CpuHit &record) {
+  // hit record of a sphere at the given distance along the ray
+  record.dist = margin;
+  record.point = r.direction * margin + r.origin;
+  vec3 out_normal =
+      (record.point - vec3(obj.sphere_center)) / obj.sphere_radius;
+  record.front_face = glm::dot(r.direction, out_normal) < 0;
+  record.normal = record.front_face ? out_normal : -1.0f * out_normal;
+}
+bool hitSphere(const NHittable &obj, const Ray &r, float dist_min,
+               float dist_max, CpuHit &record) {
+  vec3 center = vec3(obj.sphere_center);
+  float radius = obj.sphere_radius;
+  vec3 origin_to_center = r.origin - center;
+  float a = glm::dot(r.direction, r.direction);
+  float half_b = glm::dot(origin_to_center, r.direction);
+  float c = glm::dot(origin_to_center, origin_to_center) - radius * radius;
+  float isHit = half_b * half_b - a * c;
+  if (isHit <= 0) {
+    return false;
+  }
+  float root = std::sqrt(isHit);
+  float margin = (-half_b - root) / a;
+  if (!(margin < dist_max && margin > dist_min)) {
+    margin = (-half_b + root) / a;
+    if (!(margin < dist_max && margin > dist_min)) {
+      return false;
+    }
+  }
+  setSphereRecord(obj, r, margin, record);
+  return true;
+}
+bool hitBox(const BvhNode &n, const Ray &r, vec3 inv_dir, float dmin,
+            float dmax) {
+  vec3 t0 = (vec3(n.bmin) - r.origin) * inv_dir;
+  vec3 t1 = (vec3(n.bmax) - r.origin) * inv_dir;
+  vec3 tsmall = glm::min(t0, t1);
+  vec3 tbig = glm::max(t0, t1);
+  float tnear =
+      std::max(dmin, std::max(tsmall.x, std::max(tsmall.y, tsmall.z)));
+  float tfar = std::min(dmax, std::min(tbig.x, std::min(tbig.y, tbig.z)));
+  return tnear <= tfar;
+}
+bool hit_scene(const Bvh &bvh, const Ray &r, float dmin, float dmax,
+               CpuHit &record) {
+  // stackless walk over the miss links, same order as the kernels
+  CpuHit temp;
+  bool hit_ = false;
+  float current_closest = dmax;
+  vec3 inv_dir = 1.0f / r.direction;
+  int node = 0;
+  while (node != -1) {
+    const BvhNode &n = bvh.nodes[node];
+    if (hitBox(n, r, inv_dir, dmin, current_closest)) {
+      if (n.count == 0) {
+        node = n.left;
+        continue;
+      }
+      for (int i = n.left; i < n.left + n.count; i++) {
+        if (hitSphere(bvh.objects[i], r, dmin, current_closest, temp)) {
+          hit_ = true;
+          current_closest = temp.dist;
+          temp.obj_index = i;
+          record = temp;
+        }
+      }
+    }
+    node = n.miss;
+  }
+  return hit_;
+}
+
+// ------------- materials, see shaders/lib/material.glsl -------------------
+
+float fresnelCT(float costheta, float ridx) {
+  float etao = 1 + std::sqrt(ridx);
+  float etau = 1 - std::sqrt(ridx);
+  float eta = etao / etau;
+  float g = std::sqrt(eta * eta + costheta * costheta - 1);
+  float g_c = g - costheta;
+  float gplusc = g + costheta;
+  float gplus_cc = (gplusc * costheta) - 1;
+  float g_cc = (g_c * costheta) + 1;
+  float oneplus_gcc = 1 + std::pow(gplus_cc / g_cc, 2.0f);
+  float half_plus_minus = 0.5f * std::pow(g_c / gplusc, 2.0f);
+  return half_plus_minus * oneplus_gcc;
+}
+bool scatter(const NHittable &obj, const Ray &ray_in, const CpuHit &record,
+             vec3 &attenuation, Ray &ray_out, CpuSampler &smp) {
+  if (obj.material_type == 0) {
+    // the kernels aim at point + direction, kept for the same image
+    vec3 out_dir = record.point + random_in_hemisphere(record.normal, smp);
+    ray_out = makeRay(record.point, out_dir);
+    attenuation = vec3(obj.lambert_albedo);
+    return true;
+  }
+  if (obj.material_type == 1) {
+    vec3 out_dir =
+        glm::reflect(glm::normalize(ray_in.direction), record.normal);
+    ray_out = makeRay(record.point, out_dir + obj.metal_roughness *
+                                                  random_in_unit_sphere(smp));
+    attenuation = vec3(obj.metal_albedo);
+    return glm::dot(ray_out.direction, record.normal) > 0.0f;
+  }
+  if (obj.material_type == 2) {
+    attenuation = vec3(1.0f);
+    vec3 unit_in_dir = glm::normalize(ray_in.direction);
+    float eta_over = record.front_face ? 1.0f / obj.dielectric_ref_idx
+                                       : obj.dielectric_ref_idx;
+    float costheta = std::min(glm::dot(-unit_in_dir, record.normal), 1.0f);
+    float sintheta = std::sqrt(1.0f - costheta * costheta);
+    if (eta_over * sintheta > 1.0f ||
+        sample_1d(smp) < fresnelCT(costheta, eta_over)) {
+      ray_out =
+          makeRay(record.point, glm::reflect(unit_in_dir, record.normal));
+      return true;
+    }
+    ray_out = makeRay(record.point,
+                      glm::refract(unit_in_dir, record.normal, eta_over));
+    return true;
+  }
+  return false;
+}
+
+// ------------------ integrator, see shaders/weekend.comp ------------------
+
+vec3 trace_path(const Bvh &bvh, Ray r_in, bool hit, CpuHit rec, int depth,
+                CpuSampler &smp) {
+  // ray_color from a first hit that is already known, hit is false when
+  // the ray went to the sky
+  vec3 bcolor = vec3(1);
+  int max_depth = depth;
+  while (depth > 0) {
+    if (!hit) {
+      vec3 dir = glm::normalize(r_in.direction);
+      float temp = 0.5f * (dir.y + 1.0f);
+      return bcolor * (vec3(1.0f - temp) + temp * vec3(0.5f, 0.7f, 1.0f));
+    }
+    start_bounce(smp, max_depth - depth);
+    float survive = roulette_sample(smp, max_depth - depth);
+    Ray r_out;
+    vec3 atten;
+    if (!scatter(bvh.objects[rec.obj_index], r_in, rec, atten, r_out, smp)) {
+      return vec3(0);
+    }
+    r_in = r_out;
+    bcolor *= atten;
+    depth--;
+    if (max_depth - depth >= CPU_ROULETTE_DEPTH) {
+      float p = std::min(std::max(bcolor.x, std::max(bcolor.y, bcolor.z)),
+                         1.0f);
+      if (survive >= p) {
+        return vec3(0);
+      }
+      bcolor /= p;
+    }
+    if (depth > 0) {
+      hit = hit_scene(bvh, r_in, 0.001f, INFINITY, rec);
+    }
+  }
+  return vec3(0);
+}
+vec3 ray_color(const Bvh &bvh, Ray r, int depth, CpuSampler &smp) {
+  CpuHit rec;
+  bool hit = depth > 0 && hit_scene(bvh, r, 0.001f, INFINITY, rec);
+  return trace_path(bvh, r, hit, rec, depth, smp);
+}
+
+Ray get_ray(const RayCameraLens &ca, float u, float v, CpuSampler &smp) {
+  vec3 rd = ca.lens_radius * random_in_unit_disk(smp);
+  vec3 r_origin = ca.origin + ca.u * rd.x + ca.v * rd.y;
+  vec3 r_dir = ca.lower_left_corner + u * ca.horizontal + v * ca.vertical -
+               r_origin;
+  return makeRay(r_origin, r_dir);
+}
+
+// --------------------------- thread pool ----------------------------------
+
+// tasks of one worker: it takes from the front of its own queue, idle
+// workers steal from the back of the others
+struct TaskQueue {
+  std::mutex lock;
+  std::deque<int> tasks;
+};
+
+bool popTask(TaskQueue &q, bool steal, int &task) {
+  std::lock_guard<std::mutex> guard(q.lock);
+  if (q.tasks.empty()) {
+    return false;
+  }
+  if (steal) {
+    task = q.tasks.back();
+    q.tasks.pop_back();
+  } else {
+    task = q.tasks.front();
+    q.tasks.pop_front();
+  }
+  return true;
+}
+
+unsigned int runTasks(int count, unsigned int threads,
+                      const std::function<void(int)> &run) {
+  // run tasks 0 to count - 1 on the given number of threads, returns how
+  // many were stolen. Every worker starts with a contiguous range, so
+  // neighbouring tiles share caches until the load evens out.
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  for (unsigned int t = 0; t < threads; t++) {
+    queues.push_back(std::make_unique<TaskQueue>());
+    int begin = static_cast<int>(int64_t(count) * t / threads);
+    int end = static_cast<int>(int64_t(count) * (t + 1) / threads);
+    for (int task = begin; task < end; task++) {
+      queues[t]->tasks.push_back(task);
+    }
+  }
+  std::atomic<unsigned int> steals(0);
+  auto worker = [&](unsigned int self) {
+    int task;
+    while (true) {
+      if (popTask(*queues[self], false, task)) {
+        run(task);
+        continue;
+      }
+      // nothing is ever queued again, one round without a steal ends it
+      bool stolen = false;
+      for (unsigned int k = 1; k < threads && !stolen; k++) {
+        stolen = popTask(*queues[(self + k) % threads], true, task);
+      }
+      if (!stolen) {
+        return;
+      }
+      steals++;
+      run(task);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned int t = 1; t < threads; t++) {
+    pool.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto &th : pool) {
+    th.join();
+  }
+  return steals;
+}
+
+// ------------------------------- render -----------------------------------
+
+Ray cameraRay(const RayCameraLens &cam, const std::vector<GLuint> &directions,
+              unsigned int i, unsigned int j, int k, unsigned int w,
+              unsigned int h, CpuSampler &smp) {
+  // sample k is the sample of frame k of a gpu run
+  smp = makeSampler(directions, i, j, k);
+  vec2 jitter = sample_2d(smp);
+  float u = (i + jitter.x) / (float(w) - 1);
+  float v = (j + jitter.y) / (float(h) - 1);
+  return get_ray(cam, u, v, smp);
+}
+void storePixel(unsigned char *rgba, unsigned int w, unsigned int i,
+                unsigned int j, vec3 rcolor) {
+  // fix_color of the kernels, then the unorm conversion of the readback
+  unsigned char *px = rgba + (j * w + i) * 4;
+  for (int c = 0; c < 3; c++) {
+    float s = std::clamp(std::sqrt(rcolor[c] / CPU_SAMPLES), 0.0f, 1.0f);
+    px[c] = static_cast<unsigned char>(std::lround(s * 255));
+  }
+  px[3] = 255;
+}
+
+void renderTile(const Bvh &bvh, const std::vector<GLuint> &directions,
+                const RayCameraLens &cam, int tile, unsigned int w,
+                unsigned int h, unsigned char *rgba) {
+  // all samples of the pixels of one tile, rows of rgba8 bottom first like
+  // the output texture
+  unsigned int tiles_x = (w + CPU_TILE - 1) / CPU_TILE;
+  unsigned int x0 = (tile % tiles_x) * CPU_TILE;
+  unsigned int y0 = (tile / tiles_x) * CPU_TILE;
+  unsigned int x1 = std::min(x0 + CPU_TILE, w);
+  unsigned int y1 = std::min(y0 + CPU_TILE, h);
+  for (unsigned int j = y0; j < y1; j++) {
+    unsigned int i = x0;
+#ifdef PACKET_SIMD
+    // camera rays of PACKET_WIDTH pixels of the row find their first hit
+    // together, the bounces after it are incoherent and go one by one
+    for (; CPU_PACKETS && i < x1; i += PACKET_WIDTH) {
+      int lanes = std::min<int>(PACKET_WIDTH, x1 - i);
+      vec3 rcolor[PACKET_WIDTH];
+      std::fill(rcolor, rcolor + PACKET_WIDTH, vec3(0));
+      for (int k = 0; k < CPU_SAMPLES; k++) {
+        CpuSampler smp[PACKET_WIDTH];
+        Ray r[PACKET_WIDTH];
+        RayPacket packet;
+        for (int l = 0; l < lanes; l++) {
+          r[l] = cameraRay(cam, directions, i + l, j, k, w, h, smp[l]);
+          setPacketRay(packet, l, r[l]);
+        }
+        padPacket(packet, lanes);
+        PacketHit first;
+        tracePacket(bvh, packet, 0.001f, INFINITY, first);
+        for (int l = 0; l < lanes; l++) {
+          CpuHit rec = {};
+          bool hit = first.obj[l] >= 0;
+          if (hit) {
+            setSphereRecord(bvh.objects[first.obj[l]], r[l], first.dist[l],
+                            rec);
+            rec.obj_index = first.obj[l];
+          }
+          rcolor[l] += trace_path(bvh, r[l], hit, rec, CPU_MAX_DEPTH, smp[l]);
+        }
+      }
+      for (int l = 0; l < lanes; l++) {
+        storePixel(rgba, w, i + l, j, rcolor[l]);
+      }
+    }
+#endif
+    for (; i < x1; i++) {
+      vec3 rcolor = vec3(0);
+      for (int k = 0; k < CPU_SAMPLES; k++) {
+        CpuSampler smp;
+        Ray r = cameraRay(cam, directions, i, j, k, w, h, smp);
+        rcolor += ray_color(bvh, r, CPU_MAX_DEPTH, smp);
+      }
+      storePixel(rgba, w, i, j, rcolor);
+    }
+  }
+}
+
+int renderCpu(const std::vector<NHittable> &scene) {
+  // render the scene from CAMERA into CPU_OUTPUT
+  cpuFromEnv();
+  unsigned int threads = CPU_THREADS;
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  Bvh bvh = buildBvh(scene);
+  std::vector<GLuint> directions = sobolDirections();
+  unsigned int w = CPU_WIDTH;
+  unsigned int h = CPU_HEIGHT;
+  RayCameraLens cam = makeCamera(
+      CAMERA.pos, CAMERA.target, CAMERA.up, CAMERA.vfov, float(w) / float(h),
+      CAMERA.aperture, CAMERA.focus_dist, CAMERA.t0, CAMERA.t1);
+  std::vector<unsigned char> rgba(w * h * 4);
+
+  int tiles = static_cast<int>(((w + CPU_TILE - 1) / CPU_TILE) *
+                               ((h + CPU_TILE - 1) / CPU_TILE));
+  auto start = std::chrono::steady_clock::now();
+  unsigned int steals = runTasks(tiles, threads, [&](int tile) {
+    renderTile(bvh, directions, cam, tile, w, h, rgba.data());
+  });
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  std::cout << "cpu render " << w << "x" << h << ", " << CPU_SAMPLES
+            << " samples per pixel on " << threads << " threads: " << ms
+            << " ms, " << tiles << " tiles, " << steals << " stolen"
+            << std::endl;
+#ifdef PACKET_SIMD
+  if (CPU_PACKETS) {
+    std::cout << "camera rays in packets of " << PACKET_WIDTH << std::endl;
+  }
+#endif
+  if (!writeRGBA(rgba.data(), w, h, CPU_OUTPUT)) {
+    return -1;
+  }
+  std::cout << "wrote " << CPU_OUTPUT << std::endl;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+// offscreen rendering without a window: a surfaceless EGL context and a
+// fixed number of dispatches, the output texture is written with writePPM
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+//
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// render HEADLESS_FRAMES frames offscreen, write the output texture to
+// HEADLESS_OUTPUT and exit. The HEADLESS_FRAMES and HEADLESS_OUTPUT
+// environment variables turn it on for any of the executables.
+bool HEADLESS = false;
+unsigned int HEADLESS_FRAMES = 64;
+std::string HEADLESS_OUTPUT = "render.ppm";
+
+EGLDisplay headless_display = EGL_NO_DISPLAY;
+EGLContext headless_context = EGL_NO_CONTEXT;
+
+void headlessFromEnv() {
+  const char *frames = std::getenv("HEADLESS_FRAMES");
+  const char *output = std::getenv("HEADLESS_OUTPUT");
+  if (frames != NULL) {
+    HEADLESS = true;
+    HEADLESS_FRAMES = std::atoi(frames);
+  }
+  if (output != NULL) {
+    HEADLESS = true;
+    HEADLESS_OUTPUT = output;
+  }
+}
+
+bool makeSurfacelessContext(int maj, int min) {
+  // gl core context without any surface, works with mesa's llvmpipe on
+  // machines without a gpu or a display server
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay == NULL) {
+    return false;
+  }
+  headless_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                        EGL_DEFAULT_DISPLAY, NULL);
+  EGLint eglMajor, eglMinor;
+  if (headless_display == EGL_NO_DISPLAY ||
+      eglInitialize(headless_display, &eglMajor, &eglMinor) == EGL_FALSE) {
+    return false;
+  }
+  eglBindAPI(EGL_OPENGL_API);
+  const EGLint attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                            maj,
+                            EGL_CONTEXT_MINOR_VERSION,
+                            min,
+                            EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                            EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                            EGL_NONE};
+  // no config, the context only renders into textures
+  headless_context = eglCreateContext(headless_display, EGL_NO_CONFIG_KHR,
+                                      EGL_NO_CONTEXT, attribs);
+  if (headless_context == EGL_NO_CONTEXT ||
+      eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                     headless_context) == EGL_FALSE) {
+    eglTerminate(headless_display);
+    headless_display = EGL_NO_DISPLAY;
+    return false;
+  }
+  return gladLoadGLLoader((GLADloadproc)(eglGetProcAddress)) != 0;
+}
+void destroySurfacelessContext() {
+  if (headless_display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+  eglDestroyContext(headless_display, headless_context);
+  eglTerminate(headless_display);
+  headless_display = EGL_NO_DISPLAY;
+  headless_context = EGL_NO_CONTEXT;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef LBVH_HPP
+#define LBVH_HPP
+// bvh built on the gpu after Karras: morton codes of the sphere centers,
+// a radix sort, the hierarchy of the sorted codes and the boxes fitted
+// from the leaves up. The kernels write the same BvhNode layout the host
+// builders upload, so hit_scene walks either tree.
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <custom/shader.hpp>
+//
+#include "bvh.hpp"
+//
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// build the bvh with the lbvh kernels instead of on the host. The tree is
+// worse than the sah one, one object per leaf and split at the bits of the
+// morton codes, but it takes milliseconds for a few 100k spheres.
+bool GPU_BVH = false;
+// build it again before every frame, as objects moved by a kernel need
+bool GPU_BVH_EVERY_FRAME = false;
+// invocations per work group of the build passes, at least SORT_BINS
+unsigned int LBVH_WAVE_SIZE = 256;
+// work groups of the center box pass, each strides over the objects
+unsigned int LBVH_BOUNDS_GROUPS = 64;
+// 4 bit digits of the 30 bit codes, an even count ends in keys[0]
+const int LBVH_SORT_PASSES = 8;
+const int LBVH_SORT_BITS = 4;
+const int LBVH_SORT_BINS = 16;
+// highest storage buffer binding of the build kernels
+const GLint LBVH_LAST_BINDING = 13;
+
+struct GpuBvh {
+  GLuint state;     // binding 8, box of the centers
+  GLuint keys[2];   // bindings 9 and 10, swapped by every sort pass
+  GLuint histogram; // binding 11, digit counts of every work group
+  GLuint parents;   // binding 12
+  GLuint flags;     // binding 13, visits of the inner nodes by the fit pass
+  int object_count;
+  GLuint groups; // work groups of a pass over the objects
+  Shader boundsShader;
+  Shader mortonShader;
+  Shader histogramShader;
+  Shader scanShader;
+  Shader scatterShader;
+  Shader hierarchyShader;
+  Shader fitShader;
+  Shader linksShader;
+};
+
+bool supportsGpuBvh() {
+  // gl 4.3 only asks for 8 storage buffer bindings
+  GLint bindings = 0;
+  glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &bindings);
+  if (bindings <= LBVH_LAST_BINDING) {
+    std::cout << "gpu bvh needs " << LBVH_LAST_BINDING + 1
+              << " storage buffer bindings, the driver has " << bindings
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+GLuint makeBuildBuffer(std::size_t size) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  return buffer;
+}
+
+Shader makeBuildShader(const std::filesystem::path &parent,
+                       const char *compute) {
+  std::ostringstream defines;
+  defines << "#define WAVE_SIZE " << LBVH_WAVE_SIZE << "\n";
+  return Shader((parent / compute).c_str(), defines.str());
+}
+
+GpuBvh makeGpuBvh(const std::filesystem::path &parent, int object_count) {
+  // buffers and kernels of the build, the node buffer at binding 1 is the
+  // caller's and has to hold 2 * object_count - 1 nodes
+  GpuBvh gb;
+  gb.object_count = object_count;
+  gb.groups = (object_count + LBVH_WAVE_SIZE - 1) / LBVH_WAVE_SIZE;
+  std::size_t node_count = 2 * object_count - 1;
+  gb.state = makeBuildBuffer(6 * sizeof(GLuint));
+  gb.keys[0] = makeBuildBuffer(object_count * 2 * sizeof(GLuint));
+  gb.keys[1] = makeBuildBuffer(object_count * 2 * sizeof(GLuint));
+  gb.histogram = makeBuildBuffer(LBVH_SORT_BINS * gb.groups * sizeof(GLuint));
+  gb.parents = makeBuildBuffer(node_count * sizeof(GLint));
+  gb.flags = makeBuildBuffer(node_count * sizeof(GLuint));
+  gb.boundsShader = makeBuildShader(parent, "lbvh_bounds.comp");
+  gb.mortonShader = makeBuildShader(parent, "lbvh_morton.comp");
+  gb.histogramShader = makeBuildShader(parent, "lbvh_histogram.comp");
+  gb.scanShader = makeBuildShader(parent, "lbvh_scan.comp");
+  gb.scatterShader = makeBuildShader(parent, "lbvh_scatter.comp");
+  gb.hierarchyShader = makeBuildShader(parent, "lbvh_hierarchy.comp");
+  gb.fitShader = makeBuildShader(parent, "lbvh_fit.comp");
+  gb.linksShader = makeBuildShader(parent, "lbvh_links.comp");
+  return gb;
+}
+void deleteGpuBvh(GpuBvh &gb) {
+  glDeleteBuffers(1, &gb.state);
+  glDeleteBuffers(2, gb.keys);
+  glDeleteBuffers(1, &gb.histogram);
+  glDeleteBuffers(1, &gb.parents);
+  glDeleteBuffers(1, &gb.flags);
+}
+
+void dispatchBuild(const Shader &shader, const GpuBvh &gb, GLuint groups) {
+  // one pass of the build, the next one reads what it wrote
+  shader.setIntUni("object_count", gb.object_count);
+  glDispatchCompute(groups, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void buildGpuBvh(GpuBvh &gb) {
+  // build the tree over the objects at binding 0 into the nodes at
+  // binding 1, the objects keep their order
+  GLuint empty_box[6] = {0xffffffffu, 0xffffffffu, 0xffffffffu, 0, 0, 0};
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, gb.state);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(empty_box), empty_box);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, gb.state);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gb.keys[0]);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, gb.histogram);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, gb.parents);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, gb.flags);
+
+  gb.boundsShader.useProgram();
+  dispatchBuild(gb.boundsShader, gb, std::min(gb.groups, LBVH_BOUNDS_GROUPS));
+  gb.mortonShader.useProgram();
+  dispatchBuild(gb.mortonShader, gb, gb.groups);
+
+  for (int pass = 0; pass < LBVH_SORT_PASSES; pass++) {
+    // least significant digit first, every pass keeps the order of the
+    // one before for equal digits
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gb.keys[pass % 2]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, gb.keys[1 - pass % 2]);
+    gb.histogramShader.useProgram();
+    gb.histogramShader.setIntUni("sort_shift", pass * LBVH_SORT_BITS);
+    dispatchBuild(gb.histogramShader, gb, gb.groups);
+    gb.scanShader.useProgram();
+    gb.scanShader.setIntUni("sort_groups", gb.groups);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    gb.scatterShader.useProgram();
+    gb.scatterShader.setIntUni("sort_shift", pass * LBVH_SORT_BITS);
+    dispatchBuild(gb.scatterShader, gb, gb.groups);
+  }
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gb.keys[0]);
+
+  gb.hierarchyShader.useProgram();
+  dispatchBuild(gb.hierarchyShader, gb, gb.groups);
+  gb.fitShader.useProgram();
+  dispatchBuild(gb.fitShader, gb, gb.groups);
+  gb.linksShader.useProgram();
+  dispatchBuild(gb.linksShader, gb, 2 * gb.groups);
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef PACKET_HPP
+#define PACKET_HPP
+// packets of coherent rays for the cpu renderer: the camera rays of
+// neighbouring pixels walk the bvh together, 8 wide with avx2 and 4 wide
+// with sse2. avx2 needs a build for it, CPU_NATIVE in CMakeLists.txt.
+// Builds without either leave PACKET_SIMD undefined and the cpu renderer
+// traces every ray on its own.
+// license: see LICENSE
+#include "bvh.hpp"
+#include "utils.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PACKET_SIMD
+const int PACKET_WIDTH = 8;
+typedef __m256 pfloat;
+inline pfloat pset(float x) { return _mm256_set1_ps(x); }
+inline pfloat pload(const float *p) { return _mm256_load_ps(p); }
+inline void pstore(float *p, pfloat a) { _mm256_store_ps(p, a); }
+inline pfloat padd(pfloat a, pfloat b) { return _mm256_add_ps(a, b); }
+inline pfloat psub(pfloat a, pfloat b) { return _mm256_sub_ps(a, b); }
+inline pfloat pmul(pfloat a, pfloat b) { return _mm256_mul_ps(a, b); }
+inline pfloat pdiv(pfloat a, pfloat b) { return _mm256_div_ps(a, b); }
+inline pfloat pmin(pfloat a, pfloat b) { return _mm256_min_ps(a, b); }
+inline pfloat pmax(pfloat a, pfloat b) { return _mm256_max_ps(a, b); }
+inline pfloat psqrt(pfloat a) { return _mm256_sqrt_ps(a); }
+inline pfloat plt(pfloat a, pfloat b) {
+  return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+inline pfloat ple(pfloat a, pfloat b) {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+inline pfloat pand(pfloat a, pfloat b) { return _mm256_and_ps(a, b); }
+inline pfloat pselect(pfloat mask, pfloat a, pfloat b) {
+  // a where the mask is set, b elsewhere
+  return _mm256_blendv_ps(b, a, mask);
+}
+inline int pmask(pfloat mask) { return _mm256_movemask_ps(mask); }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PACKET_SIMD
+const int PACKET_WIDTH = 4;
+typedef __m128 pfloat;
+inline pfloat pset(float x) { return _mm_set1_ps(x); }
+inline pfloat pload(const float *p) { return _mm_load_ps(p); }
+inline void pstore(float *p, pfloat a) { _mm_store_ps(p, a); }
+inline pfloat padd(pfloat a, pfloat b) { return _mm_add_ps(a, b); }
+inline pfloat psub(pfloat a, pfloat b) { return _mm_sub_ps(a, b); }
+inline pfloat pmul(pfloat a, pfloat b) { return _mm_mul_ps(a, b); }
+inline pfloat pdiv(pfloat a, pfloat b) { return _mm_div_ps(a, b); }
+inline pfloat pmin(pfloat a, pfloat b) { return _mm_min_ps(a, b); }
+inline pfloat pmax(pfloat a, pfloat b) { return _mm_max_ps(a, b); }
+inline pfloat psqrt(pfloat a) { return _mm_sqrt_ps(a); }
+inline pfloat plt(pfloat a, pfloat b) { return _mm_cmplt_ps(a, b); }
+inline pfloat ple(pfloat a, pfloat b) { return _mm_cmple_ps(a, b); }
+inline pfloat pand(pfloat a, pfloat b) { return _mm_and_ps(a, b); }
+inline pfloat pselect(pfloat mask, pfloat a, pfloat b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+inline int pmask(pfloat mask) { return _mm_movemask_ps(mask); }
+#endif
+
+#ifdef PACKET_SIMD
+// trace the camera rays as packets, the CPU_PACKETS environment variable
+// turns them off to compare against single rays
+bool CPU_PACKETS = true;
+
+// rays of a packet as structure of arrays, lanes past count repeat lane 0
+struct RayPacket {
+  alignas(32) float ox[PACKET_WIDTH];
+  alignas(32) float oy[PACKET_WIDTH];
+  alignas(32) float oz[PACKET_WIDTH];
+  alignas(32) float dx[PACKET_WIDTH];
+  alignas(32) float dy[PACKET_WIDTH];
+  alignas(32) float dz[PACKET_WIDTH];
+  int count;
+};
+struct PacketHit {
+  alignas(32) float dist[PACKET_WIDTH];
+  int obj[PACKET_WIDTH]; // index into Bvh::objects, -1 for a miss
+};
+
+void setPacketRay(RayPacket &p, int lane, const Ray &r) {
+  p.ox[lane] = r.origin.x;
+  p.oy[lane] = r.origin.y;
+  p.oz[lane] = r.origin.z;
+  p.dx[lane] = r.direction.x;
+  p.dy[lane] = r.direction.y;
+  p.dz[lane] = r.direction.z;
+}
+void padPacket(RayPacket &p, int count) {
+  p.count = count;
+  for (int lane = count; lane < PACKET_WIDTH; lane++) {
+    p.ox[lane] = p.ox[0];
+    p.oy[lane] = p.oy[0];
+    p.oz[lane] = p.oz[0];
+    p.dx[lane] = p.dx[0];
+    p.dy[lane] = p.dy[0];
+    p.dz[lane] = p.dz[0];
+  }
+}
+
+void tracePacket(const Bvh &bvh, const RayPacket &p, float dmin, float dmax,
+                 PacketHit &hit) {
+  // closest hit of every lane, the same stackless walk as hit_scene. A node
+  // is entered when any lane hits its box, the spheres of a leaf are only
+  // tested for the lanes that hit the leaf.
+  pfloat ox = pload(p.ox), oy = pload(p.oy), oz = pload(p.oz);
+  pfloat dx = pload(p.dx), dy = pload(p.dy), dz = pload(p.dz);
+  pfloat one = pset(1.0f);
+  pfloat ix = pdiv(one, dx), iy = pdiv(one, dy), iz = pdiv(one, dz);
+  pfloat vmin = pset(dmin);
+  pfloat closest = pset(dmax);
+  alignas(32) float lanes[PACKET_WIDTH];
+  for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+    lanes[lane] = lane < p.count ? 1.0f : 0.0f;
+    hit.obj[lane] = -1;
+  }
+  pfloat active = plt(pset(0.0f), pload(lanes));
+  // the origin terms of the sphere test do not change from sphere to sphere
+  pfloat a = padd(padd(pmul(dx, dx), pmul(dy, dy)), pmul(dz, dz));
+
+  int node = 0;
+  while (node != -1) {
+    const BvhNode &n = bvh.nodes[node];
+    pfloat t0 = pmul(psub(pset(n.bmin.x), ox), ix);
+    pfloat t1 = pmul(psub(pset(n.bmax.x), ox), ix);
+    pfloat tnear = pmax(vmin, pmin(t0, t1));
+    pfloat tfar = pmin(closest, pmax(t0, t1));
+    t0 = pmul(psub(pset(n.bmin.y), oy), iy);
+    t1 = pmul(psub(pset(n.bmax.y), oy), iy);
+    tnear = pmax(tnear, pmin(t0, t1));
+    tfar = pmin(tfar, pmax(t0, t1));
+    t0 = pmul(psub(pset(n.bmin.z), oz), iz);
+    t1 = pmul(psub(pset(n.bmax.z), oz), iz);
+    tnear = pmax(tnear, pmin(t0, t1));
+    tfar = pmin(tfar, pmax(t0, t1));
+    pfloat enter = pand(active, ple(tnear, tfar));
+    if (pmask(enter) == 0) {
+      // the whole packet misses the box
+      node = n.miss;
+      continue;
+    }
+    if (n.count == 0) {
+      node = n.left;
+      continue;
+    }
+    for (int i = n.left; i < n.left + n.count; i++) {
+      const NHittable &obj = bvh.objects[i];
+      pfloat cx = psub(ox, pset(obj.sphere_center.x));
+      pfloat cy = psub(oy, pset(obj.sphere_center.y));
+      pfloat cz = psub(oz, pset(obj.sphere_center.z));
+      pfloat half_b = padd(padd(pmul(cx, dx), pmul(cy, dy)), pmul(cz, dz));
+      pfloat c = psub(padd(padd(pmul(cx, cx), pmul(cy, cy)), pmul(cz, cz)),
+                      pset(obj.sphere_radius * obj.sphere_radius));
+      pfloat disc = psub(pmul(half_b, half_b), pmul(a, c));
+      pfloat real = pand(enter, plt(pset(0.0f), disc));
+      if (pmask(real) == 0) {
+        continue;
+      }
+      pfloat root = psqrt(pmax(disc, pset(0.0f)));
+      pfloat nb = psub(pset(0.0f), half_b);
+      // nearer root when it is in range, the farther one otherwise
+      pfloat margin = pdiv(psub(nb, root), a);
+      pfloat in_range = pand(plt(margin, closest), plt(vmin, margin));
+      pfloat far_margin = pdiv(padd(nb, root), a);
+      pfloat far_range = pand(plt(far_margin, closest), plt(vmin, far_margin));
+      margin = pselect(in_range, margin, far_margin);
+      pfloat got = pand(real, pselect(in_range, in_range, far_range));
+      int bits = pmask(got);
+      if (bits == 0) {
+        continue;
+      }
+      closest = pselect(got, margin, closest);
+      for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+        if (bits & (1 << lane)) {
+          hit.obj[lane] = i;
+        }
+      }
+    }
+    node = n.miss;
+  }
+  pstore(hit.dist, closest);
+}
+#endif
+
+#endif
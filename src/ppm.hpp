@@ -0,0 +1,33 @@
+#ifndef PPM_HPP
+#define PPM_HPP
+// binary ppm output shared by the gpu readback and the cpu renderer
+// license: see LICENSE
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+bool writeRGBA(const unsigned char *rgba, unsigned int w, unsigned int h,
+               const std::string &path) {
+  // binary ppm of rgba8 rows, the first row is the bottom of the image
+  std::vector<unsigned char> rgb(w * h * 3);
+  for (unsigned int j = 0; j < h; j++) {
+    const unsigned char *row = rgba + (h - 1 - j) * w * 4;
+    for (unsigned int i = 0; i < w; i++) {
+      for (int c = 0; c < 3; c++) {
+        rgb[(j * w + i) * 3 + c] = row[i * 4 + c];
+      }
+    }
+  }
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (f == NULL) {
+    std::cout << "Failed writing " << path << std::endl;
+    return false;
+  }
+  std::fprintf(f, "P6\n%u %u\n255\n", w, h);
+  std::fwrite(rgb.data(), 1, rgb.size(), f);
+  std::fclose(f);
+  return true;
+}
+
+#endif
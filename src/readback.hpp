@@ -0,0 +1,167 @@
+#ifndef READBACK_HPP
+#define READBACK_HPP
+// output texture back to the cpu: a blocking read for the last frame of a
+// headless run and a ring of pixel buffer objects to record every frame
+// without waiting on the gpu
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include "ppm.hpp"
+//
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// record the frames of a render loop, RECORD_PATTERN is the printf pattern
+// of the file names with the frame number, "frame%04u.ppm" for example.
+// Empty records nothing, the RECORD_PATTERN environment variable sets it.
+std::string RECORD_PATTERN = "";
+// frames in flight: frame n is copied while frame n - 2 is written out
+const int READBACK_RING = 3;
+
+void recordFromEnv() {
+  const char *pattern = std::getenv("RECORD_PATTERN");
+  if (pattern != NULL) {
+    RECORD_PATTERN = pattern;
+  }
+}
+
+bool writePPM(GLuint texture, unsigned int w, unsigned int h,
+              const std::string &path) {
+  // blocking read of the texture, the driver converts it to rgba8
+  std::vector<unsigned char> rgba(w * h * 4);
+  glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if (!writeRGBA(rgba.data(), w, h, path)) {
+    return false;
+  }
+  std::cout << "wrote " << path << std::endl;
+  return true;
+}
+
+struct ReadbackRing {
+  GLuint pbos[READBACK_RING];
+  GLsync fences[READBACK_RING]; // signaled once the copy into the pbo is done
+  unsigned int frames[READBACK_RING]; // frame number held by each pbo
+  unsigned int w, h;
+  unsigned int frame; // frames queued so far
+  int next;           // pbo the next frame is copied into
+  unsigned int stalls; // reads that had to wait for the gpu
+};
+
+ReadbackRing makeReadback(unsigned int w, unsigned int h) {
+  ReadbackRing rb;
+  rb.w = w;
+  rb.h = h;
+  rb.frame = 0;
+  rb.next = 0;
+  rb.stalls = 0;
+  for (int i = 0; i < READBACK_RING; i++) {
+    rb.pbos[i] = 0;
+    rb.fences[i] = 0;
+    rb.frames[i] = 0;
+  }
+  if (RECORD_PATTERN.empty()) {
+    return rb;
+  }
+  glGenBuffers(READBACK_RING, rb.pbos);
+  for (int i = 0; i < READBACK_RING; i++) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbos[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, w * h * 4, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return rb;
+}
+
+void consumeReadback(ReadbackRing &rb, int slot) {
+  // wait for the copy of the slot, normally done frames ago, and write it
+  if (rb.fences[slot] == 0) {
+    return;
+  }
+  GLenum status = glClientWaitSync(rb.fences[slot], 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    rb.stalls++;
+    do {
+      status = glClientWaitSync(rb.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+  }
+  glDeleteSync(rb.fences[slot]);
+  rb.fences[slot] = 0;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbos[slot]);
+  const unsigned char *rgba = static_cast<const unsigned char *>(
+      glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rb.w * rb.h * 4,
+                       GL_MAP_READ_BIT));
+  if (rgba != NULL) {
+    char path[1024];
+    std::snprintf(path, sizeof(path), RECORD_PATTERN.c_str(),
+                  rb.frames[slot]);
+    writeRGBA(rgba, rb.w, rb.h, path);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void resizeReadback(ReadbackRing &rb, unsigned int w, unsigned int h) {
+  // write out the frames of the old size, then size the ring anew. Frame
+  // numbers go on.
+  if (RECORD_PATTERN.empty()) {
+    rb.w = w;
+    rb.h = h;
+    return;
+  }
+  for (int i = 0; i < READBACK_RING; i++) {
+    consumeReadback(rb, (rb.next + i) % READBACK_RING);
+  }
+  rb.w = w;
+  rb.h = h;
+  for (int i = 0; i < READBACK_RING; i++) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbos[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, w * h * 4, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void recordFrame(ReadbackRing &rb, GLuint texture) {
+  // queue an asynchronous copy of the texture, then write out the frame
+  // queued READBACK_RING - 1 frames ago
+  if (RECORD_PATTERN.empty()) {
+    return;
+  }
+  int slot = rb.next;
+  // the slot still holds a frame when the ring has wrapped without a read
+  consumeReadback(rb, slot);
+  glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbos[slot]);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  // with a pack buffer bound the pointer is an offset into it
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  rb.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  rb.frames[slot] = rb.frame;
+  rb.frame++;
+  rb.next = (slot + 1) % READBACK_RING;
+  // oldest frame in the ring
+  consumeReadback(rb, rb.next);
+}
+
+void deleteReadback(ReadbackRing &rb) {
+  // write out the frames still in flight, oldest first
+  if (RECORD_PATTERN.empty()) {
+    return;
+  }
+  for (int i = 0; i < READBACK_RING; i++) {
+    consumeReadback(rb, (rb.next + i) % READBACK_RING);
+  }
+  glDeleteBuffers(READBACK_RING, rb.pbos);
+  std::cout << "recorded " << rb.frame << " frames, " << rb.stalls
+            << " of them waited on the gpu" << std::endl;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef RESOLUTION_HPP
+#define RESOLUTION_HPP
+// dynamic resolution: the kernels render below the window resolution when a
+// frame takes longer than FRAME_BUDGET_MS, the quad pass scales the output
+// up to the window
+// license: see LICENSE
+#include "headless.hpp"
+#include "timing.hpp"
+//
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// scale the render resolution to the gpu time of a frame, needs TIMING.
+// Headless runs always render at the full size.
+bool DYNAMIC_RESOLUTION = false;
+float FRAME_BUDGET_MS = 16.0f;
+float RENDER_SCALE_MIN = 0.25f; // per axis
+// full resolution frames measured after every restart of the accumulation
+// before the scale is reconsidered
+int RESOLUTION_FRAMES = 8;
+// relative distance to the budget that is left alone, keeps the scale from
+// restarting the accumulation over and over
+float RESOLUTION_TOLERANCE = 0.2f;
+
+struct ResolutionController {
+  float scale;   // render size over window size, per axis
+  double sum_ms; // gpu time of the frames measured so far
+  int frames;
+  bool measure; // the frame before rendered at full resolution
+  bool settled; // the scale stays until the accumulation restarts
+};
+
+ResolutionController makeResolution() {
+  ResolutionController rc;
+  rc.scale = 1.0f;
+  rc.sum_ms = 0;
+  rc.frames = 0;
+  rc.measure = false;
+  rc.settled = false;
+  return rc;
+}
+void restartResolution(ResolutionController &rc) {
+  // measure again, the view or the render size changed
+  rc.sum_ms = 0;
+  rc.frames = 0;
+  rc.measure = false;
+  rc.settled = false;
+}
+
+unsigned int scaledSize(unsigned int size, float scale) {
+  long scaled = std::lround(size * scale);
+  return static_cast<unsigned int>(std::max(scaled, 1L));
+}
+
+void updateResolution(ResolutionController &rc, const FrameTimer &ft,
+                      bool refined) {
+  // call after endFrame with whether the frame rendered every pixel, the
+  // render targets follow a new scale on the next frame. Gpu times arrive a
+  // frame late, so the times read now belong to the frame before.
+  bool measure = rc.measure;
+  rc.measure = refined;
+  if (!DYNAMIC_RESOLUTION || HEADLESS || !TIMING || rc.settled || !measure) {
+    return;
+  }
+  double ray_ms = ft.passes[RAY_PASS].last_ms;
+  if (ray_ms < 0) {
+    return;
+  }
+  double denoise_ms = std::max(ft.passes[DENOISE_PASS].last_ms, 0.0);
+  rc.sum_ms += ray_ms + denoise_ms;
+  rc.frames++;
+  if (rc.frames < RESOLUTION_FRAMES) {
+    return;
+  }
+  rc.settled = true;
+  double mean_ms = rc.sum_ms / rc.frames;
+  if (std::abs(mean_ms / FRAME_BUDGET_MS - 1) < RESOLUTION_TOLERANCE) {
+    return;
+  }
+  // the cost of a frame follows its pixel count, the square of the scale
+  float scale = rc.scale * std::sqrt(FRAME_BUDGET_MS / mean_ms);
+  scale = std::clamp(scale, RENDER_SCALE_MIN, 1.0f);
+  if (std::abs(scale - rc.scale) < 0.01f) {
+    return;
+  }
+  std::cout << "render scale " << rc.scale << " -> " << scale << ", "
+            << mean_ms << " ms per frame" << std::endl;
+  rc.scale = scale;
+}
+
+#endif
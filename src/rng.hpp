@@ -0,0 +1,114 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+// pcg32 random numbers of the host. Every thread, tile and pixel draws from
+// its own part of the sequence, found by jumping ahead. Threads are
+// numbered as they first draw, the main thread is always 0. Work that has
+// to come out the same on any thread takes the generator of its tile or
+// pixel.
+// license: see LICENSE
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// seed of every generator, changing it changes every random scene
+uint64_t RNG_SEED = 0x853c49e6748fea9bull;
+// draws between the start of two thread, tile or pixel generators
+const uint64_t RNG_THREAD_STRIDE = 1ull << 48;
+const uint64_t RNG_TILE_STRIDE = 1ull << 40;
+const uint64_t RNG_PIXEL_STRIDE = 1ull << 20;
+// sequences of the generators, the inc of the lcg
+const uint64_t RNG_THREAD_STREAM = 0;
+const uint64_t RNG_TILE_STREAM = 1;
+
+const uint64_t PCG_MULT = 6364136223846793005ull;
+
+struct Pcg32 {
+  uint64_t state;
+  uint64_t inc; // odd, selects one of 2^63 sequences
+};
+
+inline uint32_t nextUint(Pcg32 &rng) {
+  // xsh rr output of the lcg state
+  uint64_t old = rng.state;
+  rng.state = old * PCG_MULT + rng.inc;
+  uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+  uint32_t rot = static_cast<uint32_t>(old >> 59u);
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31u));
+}
+inline float nextFloat(Pcg32 &rng) {
+  // [0, 1) from the upper 24 bits, every value is exact
+  return (nextUint(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+Pcg32 makePcg32(uint64_t seed, uint64_t stream) {
+  Pcg32 rng;
+  rng.state = 0;
+  rng.inc = (stream << 1u) | 1u;
+  nextUint(rng);
+  rng.state += seed;
+  nextUint(rng);
+  return rng;
+}
+void advance(Pcg32 &rng, uint64_t delta) {
+  // skip delta draws in log2(delta) steps: the lcg applied delta times is
+  // again an lcg, its multiplier and increment are built by squaring
+  uint64_t acc_mult = 1;
+  uint64_t acc_plus = 0;
+  uint64_t cur_mult = PCG_MULT;
+  uint64_t cur_plus = rng.inc;
+  while (delta > 0) {
+    if (delta & 1) {
+      acc_mult *= cur_mult;
+      acc_plus = acc_plus * cur_mult + cur_plus;
+    }
+    cur_plus = (cur_mult + 1) * cur_plus;
+    cur_mult *= cur_mult;
+    delta /= 2;
+  }
+  rng.state = acc_mult * rng.state + acc_plus;
+}
+
+void fillUniform(Pcg32 &rng, float *out, size_t n, float min, float max) {
+  // n uniform floats in [min, max)
+  float scale = max - min;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = min + scale * nextFloat(rng);
+  }
+}
+
+Pcg32 makeStreamRng(uint64_t stream, uint64_t offset) {
+  Pcg32 rng = makePcg32(RNG_SEED, stream);
+  advance(rng, offset);
+  return rng;
+}
+Pcg32 makeThreadRng(unsigned int thread) {
+  return makeStreamRng(RNG_THREAD_STREAM, thread * RNG_THREAD_STRIDE);
+}
+Pcg32 makeTileRng(unsigned int tile) {
+  return makeStreamRng(RNG_TILE_STREAM, tile * RNG_TILE_STRIDE);
+}
+Pcg32 makePixelRng(unsigned int tile, unsigned int pixel) {
+  // pixel of a tile, the tile generator itself keeps the first stride
+  return makeStreamRng(RNG_TILE_STREAM, tile * RNG_TILE_STRIDE +
+                                            (pixel + 1) * RNG_PIXEL_STRIDE);
+}
+
+// static initialization runs on the main thread
+const std::thread::id rng_main_thread = std::this_thread::get_id();
+// numbers handed to the other threads so far
+std::atomic<unsigned int> rng_threads(1);
+
+unsigned int threadRngNumber() {
+  // number of the calling thread's generator, fixed at its first call
+  static thread_local unsigned int number =
+      std::this_thread::get_id() == rng_main_thread ? 0 : rng_threads++;
+  return number;
+}
+Pcg32 &threadRng() {
+  // generator of the calling thread, no two threads share one
+  static thread_local Pcg32 rng = makeThreadRng(threadRngNumber());
+  return rng;
+}
+
+#endif
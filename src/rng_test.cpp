@@ -0,0 +1,72 @@
+// checks of the host generators, run by ctest
+// license: see LICENSE
+#include "rng.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+const int DRAWS = 16;
+
+std::vector<uint32_t> draws(Pcg32 rng) {
+  std::vector<uint32_t> out(DRAWS);
+  for (int i = 0; i < DRAWS; i++) {
+    out[i] = nextUint(rng);
+  }
+  return out;
+}
+
+int failures = 0;
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cout << "failed: " << what << std::endl;
+    failures++;
+  }
+}
+
+int main() {
+  // the main thread draws from generator 0
+  std::vector<uint32_t> main_draws = draws(threadRng());
+  check(main_draws == draws(makeThreadRng(0)), "main thread is generator 0");
+
+  // two other threads each get a generator of their own
+  std::vector<uint32_t> a, b;
+  unsigned int na = 0, nb = 0;
+  std::thread ta([&] {
+    a = draws(threadRng());
+    na = threadRngNumber();
+  });
+  std::thread tb([&] {
+    b = draws(threadRng());
+    nb = threadRngNumber();
+  });
+  ta.join();
+  tb.join();
+  check(na != 0 && nb != 0 && na != nb, "threads have distinct numbers");
+  check(a != b && a != main_draws && b != main_draws,
+        "threads draw different sequences");
+  check(a == draws(makeThreadRng(na)) && b == draws(makeThreadRng(nb)),
+        "a thread's draws are those of its number");
+
+  // tiles and pixels reproduce their sequences and differ from each other
+  check(draws(makeTileRng(3)) == draws(makeTileRng(3)), "tile reproduces");
+  check(draws(makeTileRng(3)) != draws(makeTileRng(4)), "tiles differ");
+  check(draws(makePixelRng(3, 5)) == draws(makePixelRng(3, 5)),
+        "pixel reproduces");
+  check(draws(makePixelRng(3, 5)) != draws(makePixelRng(3, 6)),
+        "pixels differ");
+  check(draws(makePixelRng(3, 0)) != draws(makeTileRng(3)),
+        "pixel differs from its tile");
+
+  // jumping ahead lands where drawing one by one does
+  Pcg32 stepped = makePcg32(RNG_SEED, RNG_TILE_STREAM);
+  for (int i = 0; i < 1000; i++) {
+    nextUint(stepped);
+  }
+  check(draws(stepped) == draws(makeStreamRng(RNG_TILE_STREAM, 1000)),
+        "advance matches single steps");
+
+  if (failures == 0) {
+    std::cout << "rng checks passed" << std::endl;
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+// sobol direction numbers for the low discrepancy sampler of the compute
+// shaders, the shaders scramble the points per pixel and per dimension
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <vector>
+
+// dimensions of the uploaded table, same as SOBOL_DIMS of the shaders.
+// Dimensions past it are padded with differently scrambled copies.
+const int SOBOL_DIMS = 16;
+// bits of a sobol point, one direction number per bit
+const int SOBOL_BITS = 32;
+
+struct SobolPolynomial {
+  int degree;          // s
+  unsigned int coeffs; // a, inner coefficients of the primitive polynomial
+  unsigned int m[6];   // initial direction numbers m_1 ... m_s
+};
+
+// dimensions 2 to 16 of the new-joe-kuo-6.21201 table, the first dimension
+// is the van der corput sequence
+const SobolPolynomial SOBOL_TABLE[SOBOL_DIMS - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}}};
+
+std::vector<GLuint> sobolDirections() {
+  // SOBOL_BITS direction numbers per dimension, dimension major
+  std::vector<GLuint> v(SOBOL_DIMS * SOBOL_BITS);
+  for (int i = 0; i < SOBOL_BITS; i++) {
+    v[i] = 1u << (31 - i);
+  }
+  for (int d = 1; d < SOBOL_DIMS; d++) {
+    const SobolPolynomial &p = SOBOL_TABLE[d - 1];
+    GLuint *dv = &v[d * SOBOL_BITS];
+    int s = p.degree;
+    for (int i = 0; i < s; i++) {
+      dv[i] = p.m[i] << (31 - i);
+    }
+    // recurrence of the primitive polynomial
+    for (int i = s; i < SOBOL_BITS; i++) {
+      dv[i] = dv[i - s] ^ (dv[i - s] >> s);
+      for (int k = 1; k < s; k++) {
+        if ((p.coeffs >> (s - 1 - k)) & 1) {
+          dv[i] ^= dv[i - k];
+        }
+      }
+    }
+  }
+  return v;
+}
+
+#endif
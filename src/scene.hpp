@@ -0,0 +1,100 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+// scenes of the examples, built once on the host and uploaded to the scene
+// buffer of the compute shaders
+// license: see LICENSE
+#include "utils.hpp"
+#include <string>
+#include <vector>
+
+std::vector<NHittable> twoSphereScene() {
+  // small sphere sitting on a big one, compute01 to compute03
+  std::vector<NHittable> scene;
+  scene.push_back(makeLambertSphere(vec3(0, -100.5, -1), 100, vec3(0.5)));
+  scene.push_back(makeLambertSphere(vec3(0, 0, -1), 0.5, vec3(0.5)));
+  return scene;
+}
+
+std::vector<NHittable> checkeredScene() {
+  // two checkered spheres, compute04 and compute07
+  std::vector<NHittable> scene;
+  scene.push_back(
+      makeCheckeredSphere(vec3(0, 10, 0), 10, vec3(1), vec3(0.2)));
+  scene.push_back(
+      makeCheckeredSphere(vec3(0, -10, 0), 10, vec3(1), vec3(0.2)));
+  return scene;
+}
+
+std::vector<NHittable> earthScene() {
+  // image textured sphere, compute05
+  std::vector<NHittable> scene;
+  scene.push_back(makeImageSphere(vec3(0, -10, 0), 10));
+  return scene;
+}
+
+std::vector<NHittable> perlinScene() {
+  // perlin noise textured spheres, compute06
+  std::vector<NHittable> scene;
+  scene.push_back(makeNoiseSphere(vec3(0, -1000, 0), 1000, 0.8));
+  scene.push_back(makeNoiseSphere(vec3(0, 2, 0), 2, 0.8));
+  return scene;
+}
+
+std::vector<NHittable> randomScene(int extent) {
+  // cover scene of the weekend book, small spheres on a (2 * extent)^2 grid
+  std::vector<NHittable> scene;
+
+  //---------------- ground ------------------------
+  scene.push_back(makeLambertSphere(vec3(0, -1000, 0), 1000, vec3(0.5)));
+  // ----------------------------------------------
+  for (int a = -extent; a < extent; a++) {
+    for (int b = -extent; b < extent; b++) {
+      float choose_mat = random_double();
+      vec3 center =
+          vec3(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+      if (glm::length(center - vec3(4, 0.2, 0)) > 0.9) {
+        if (choose_mat < 0.8) {
+          // diffuse
+          scene.push_back(
+              makeLambertSphere(center, 0.2, random_vec() * random_vec()));
+        } else if (choose_mat < 0.95) {
+          // metal
+          scene.push_back(makeMetalSphere(center, 0.2, random_vec(0.5, 1),
+                                          random_double(0, 0.5)));
+        } else {
+          // glass
+          scene.push_back(makeDielectricSphere(center, 0.2, 1.5));
+        }
+      }
+    }
+  }
+  scene.push_back(makeDielectricSphere(vec3(0, 1, 0), 1.0, 1.5));
+  scene.push_back(makeLambertSphere(vec3(-4, 1, 0), 1.0, vec3(0.4, 0.2, 0.1)));
+  scene.push_back(makeMetalSphere(vec3(4, 1, 0), 1.0, vec3(0.7, 0.6, 0.5), 0));
+  return scene;
+}
+std::vector<NHittable> randomScene() {
+  // 485 objects as in the book
+  return randomScene(11);
+}
+
+std::string sceneDefines(const std::vector<NHittable> &scene) {
+  // kernel variant of the scene, the scatter code of materials the scene
+  // does not use is compiled out
+  bool metal = false;
+  bool dielectric = false;
+  for (const auto &obj : scene) {
+    metal = metal || obj.material_type == 1;
+    dielectric = dielectric || obj.material_type == 2;
+  }
+  std::string defines;
+  if (!metal) {
+    defines += "#define NO_METAL\n";
+  }
+  if (!dielectric) {
+    defines += "#define NO_DIELECTRIC\n";
+  }
+  return defines;
+}
+
+#endif
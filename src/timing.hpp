@@ -0,0 +1,238 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+// gpu timestamp queries around the passes of a frame and cpu frame timing,
+// kept as rolling percentiles for the window title and a csv file
+// license: see LICENSE
+#include <glad/glad.h>
+//
+#include <GLFW/glfw3.h>
+//
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// gpu and cpu timing of the render loops, the percentiles are printed when
+// the window closes
+bool TIMING = true;
+// show the percentiles in the window title, refreshed every
+// TIMING_OVERLAY_FRAMES frames
+bool TIMING_OVERLAY = false;
+int TIMING_OVERLAY_FRAMES = 30;
+// one row per frame, empty for no file
+std::string TIMING_CSV = "";
+// frames the rolling percentiles look back on
+int TIMING_WINDOW = 240;
+
+typedef std::chrono::steady_clock::time_point TimePoint;
+TimePoint timeNow() { return std::chrono::steady_clock::now(); }
+double elapsedMs(TimePoint since) {
+  return std::chrono::duration<double, std::milli>(timeNow() - since).count();
+}
+
+struct RollingStat {
+  std::vector<double> values; // ring of the last TIMING_WINDOW values
+  int next;
+};
+void addStat(RollingStat &stat, double value) {
+  if (static_cast<int>(stat.values.size()) < TIMING_WINDOW) {
+    stat.values.push_back(value);
+    return;
+  }
+  stat.values[stat.next] = value;
+  stat.next = (stat.next + 1) % TIMING_WINDOW;
+}
+double percentile(const RollingStat &stat, double p) {
+  // nearest rank percentile of the window, 0 when it is empty
+  if (stat.values.empty()) {
+    return 0;
+  }
+  std::vector<double> v(stat.values);
+  size_t rank = static_cast<size_t>(p / 100.0 * (v.size() - 1) + 0.5);
+  std::nth_element(v.begin(), v.begin() + rank, v.end());
+  return v[rank];
+}
+
+struct GpuPass {
+  std::string name;
+  // timestamps before and after the pass, double buffered: frame n reads
+  // what frame n - 1 issued
+  GLuint queries[2][2];
+  bool issued[2];
+  double last_ms; // -1 when the pass did not run or its result is missing
+  RollingStat ms;
+};
+
+struct FrameTimer {
+  std::string title; // window title the overlay is appended to
+  std::vector<GpuPass> passes;
+  RollingStat frame_ms; // cpu time between two endFrame calls
+  RollingStat swap_ms;  // cpu time of glfwSwapBuffers
+  double swap_now_ms;   // swap of the current frame
+  double last_frame_ms; // cpu times of the frame whose gpu times come next
+  double last_swap_ms;
+  int frame;
+  TimePoint frame_start;
+  std::ofstream csv;
+};
+
+// gpu passes of the render loops
+enum TimedPass { RAY_PASS, DENOISE_PASS, DRAW_PASS, BVH_PASS };
+const char *TIMED_PASS_NAMES[] = {"ray", "denoise", "draw", "bvh"};
+
+FrameTimer makeFrameTimer(const char *title) {
+  FrameTimer ft;
+  ft.title = title;
+  ft.frame_ms.next = 0;
+  ft.swap_ms.next = 0;
+  ft.swap_now_ms = -1;
+  ft.last_frame_ms = -1;
+  ft.last_swap_ms = -1;
+  ft.frame = 0;
+  ft.frame_start = timeNow();
+  for (const char *name : TIMED_PASS_NAMES) {
+    GpuPass pass;
+    pass.name = name;
+    glGenQueries(4, &pass.queries[0][0]);
+    pass.issued[0] = false;
+    pass.issued[1] = false;
+    pass.last_ms = -1;
+    pass.ms.next = 0;
+    ft.passes.push_back(pass);
+  }
+  if (TIMING && !TIMING_CSV.empty()) {
+    ft.csv.open(TIMING_CSV);
+    ft.csv << "frame,cpu_frame_ms,cpu_swap_ms";
+    for (const auto &pass : ft.passes) {
+      ft.csv << ",gpu_" << pass.name << "_ms";
+    }
+    ft.csv << std::endl;
+  }
+  return ft;
+}
+
+void beginPass(FrameTimer &ft, TimedPass pass) {
+  // timestamps instead of GL_TIME_ELAPSED, llvmpipe leaves compute work out
+  // of elapsed time queries
+  if (TIMING) {
+    GpuPass &p = ft.passes[pass];
+    glQueryCounter(p.queries[ft.frame % 2][0], GL_TIMESTAMP);
+    p.issued[ft.frame % 2] = true;
+  }
+}
+void endPass(FrameTimer &ft, TimedPass pass) {
+  if (TIMING) {
+    glQueryCounter(ft.passes[pass].queries[ft.frame % 2][1], GL_TIMESTAMP);
+  }
+}
+
+void swapBuffers(FrameTimer &ft, GLFWwindow *window) {
+  TimePoint start = timeNow();
+  glfwSwapBuffers(window);
+  ft.swap_now_ms = elapsedMs(start);
+}
+
+std::string timingSummary(const FrameTimer &ft) {
+  // p50/p95/p99 in milliseconds of every timer that has values
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(2);
+  auto add = [&s](const std::string &name, const RollingStat &stat) {
+    if (!stat.values.empty()) {
+      s << " | " << name << " " << percentile(stat, 50) << "/"
+        << percentile(stat, 95) << "/" << percentile(stat, 99);
+    }
+  };
+  add("frame", ft.frame_ms);
+  add("swap", ft.swap_ms);
+  for (const auto &pass : ft.passes) {
+    add(pass.name, pass.ms);
+  }
+  return s.str();
+}
+
+void readPasses(FrameTimer &ft, int parity, bool record) {
+  // results of the frame before, they are ready by now or the frame is
+  // dropped from the statistics instead of stalling the pipeline
+  for (auto &pass : ft.passes) {
+    pass.last_ms = -1;
+    if (!pass.issued[parity]) {
+      continue;
+    }
+    pass.issued[parity] = false;
+    GLint available = 0;
+    glGetQueryObjectiv(pass.queries[parity][1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (available == 0) {
+      continue;
+    }
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(pass.queries[parity][0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(pass.queries[parity][1], GL_QUERY_RESULT, &end);
+    pass.last_ms = (end - begin) / 1e6;
+    if (record) {
+      addStat(pass.ms, pass.last_ms);
+    }
+  }
+}
+
+void writeRow(FrameTimer &ft, int frame) {
+  // gpu times of a frame are only known one frame later. The first frame
+  // pays for the driver compiling the shaders and is left out.
+  readPasses(ft, frame % 2, frame > 0);
+  if (frame > 0 && ft.csv.is_open()) {
+    ft.csv << frame << "," << ft.last_frame_ms << "," << ft.last_swap_ms;
+    for (const auto &pass : ft.passes) {
+      ft.csv << "," << pass.last_ms;
+    }
+    ft.csv << "\n";
+  }
+}
+
+void endFrame(FrameTimer &ft, GLFWwindow *window) {
+  // call once per frame after the swap
+  if (!TIMING) {
+    return;
+  }
+  double frame_ms = elapsedMs(ft.frame_start);
+  ft.frame_start = timeNow();
+  if (ft.frame > 0) {
+    addStat(ft.frame_ms, frame_ms);
+    if (ft.swap_now_ms >= 0) {
+      addStat(ft.swap_ms, ft.swap_now_ms);
+    }
+    writeRow(ft, ft.frame - 1);
+  }
+  ft.last_frame_ms = frame_ms;
+  ft.last_swap_ms = ft.swap_now_ms;
+  ft.swap_now_ms = -1; // headless frames do not swap
+  ft.frame++;
+  if (TIMING_OVERLAY && window != NULL &&
+      ft.frame % TIMING_OVERLAY_FRAMES == 0) {
+    std::string title = ft.title + timingSummary(ft);
+    glfwSetWindowTitle(window, title.c_str());
+  }
+}
+
+void deleteFrameTimer(FrameTimer &ft) {
+  if (TIMING && ft.frame > 0) {
+    // wait for the queries of the last frame
+    glFinish();
+    writeRow(ft, ft.frame - 1);
+    std::cout << "timing p50/p95/p99 ms over the last "
+              << ft.frame_ms.values.size() << " frames" << timingSummary(ft)
+              << std::endl;
+  }
+  for (auto &pass : ft.passes) {
+    glDeleteQueries(4, &pass.queries[0][0]);
+  }
+  if (ft.csv.is_open()) {
+    ft.csv.close();
+  }
+}
+
+#endif
@@ -3,11 +3,13 @@
 // some utility functions that model compute shader functions
 #include <glm/glm.hpp>
 
+#include "rng.hpp"
+
 #include <cmath>
 #include <cstdlib>
 #include <functional>
 #include <numeric>
-#include <random>
+#include <vector>
 
 using vec3 = glm::vec3;
 using vec4 = glm::vec4;
@@ -22,11 +24,8 @@ inline float degree_to_radian(float degree) {
 //
 //
 inline float random_double(float min, float max) {
-  // random double number in range [min, max]
-  static std::uniform_real_distribution<float> distr(min, max);
-  static thread_local std::mt19937 gen;
-  static std::function<float()> rand_gen = std::bind(distr, gen);
-  return rand_gen();
+  // random float in [min, max) from the generator of the calling thread
+  return min + (max - min) * nextFloat(threadRng());
 }
 
 inline float random_double() { return random_double(0, 1); }
@@ -34,14 +33,15 @@ inline int random_int() { return static_cast<int>(random_double()); }
 inline int random_int(int min, int max) {
   return static_cast<int>(random_double(min, max));
 }
+vec3 random_vec(float mi, float ma) {
+  // random vector in given seed, components drawn in x, y, z order
+  float v[3];
+  fillUniform(threadRng(), v, 3, mi, ma);
+  return vec3(v[0], v[1], v[2]);
+}
 vec3 random_vec() {
   // random vector
-  return vec3(random_double(), random_double(), random_double());
-}
-vec3 random_vec(float mi, float ma) {
-  // random vector in given seed
-  return vec3(random_double(mi, ma), random_double(mi, ma),
-              random_double(mi, ma));
+  return random_vec(0, 1);
 }
 vec3 random_in_unit_sphere() {
   // random in unit sphere
@@ -109,13 +109,18 @@ struct RayCameraLens {
   vec3 v;
   vec3 w;
   float lens_radius;
+  float time0; // shutter open time
+  float time1; // shutter close time
 };
 RayCameraLens makeCamera(vec3 pos, vec3 target, vec3 up, float vfov,
-                         float aspect_ratio, float aperture, float focus_dist) {
+                         float aspect_ratio, float aperture, float focus_dist,
+                         float t0, float t1) {
   // make camera struct
   RayCameraLens cam;
   cam.origin = pos;
   cam.lens_radius = aperture / 2;
+  cam.time0 = t0;
+  cam.time1 = t1;
 
   float theta = degree_to_radian(vfov);
   float half_height = tan(theta / 2);
@@ -133,16 +138,46 @@ RayCameraLens makeCamera(vec3 pos, vec3 target, vec3 up, float vfov,
   return cam;
 }
 
+// where the camera looks from and how its lens is set
+struct CameraSettings {
+  vec3 pos;
+  vec3 target;
+  vec3 up;
+  float vfov; // vertical field of view in degrees
+  float aperture;
+  float focus_dist;
+  float t0; // shutter open time
+  float t1; // shutter close time
+};
+// camera of the examples, the weekend scenes open the lens
+CameraSettings CAMERA = {vec3(13, 2, 3), vec3(0, 0, 0), vec3(0, 1, 0), 20, 0,
+                         10, 0, 1};
+CameraSettings weekendCamera() {
+  CameraSettings cs = CAMERA;
+  cs.vfov = 30;
+  cs.aperture = 0.1;
+  cs.focus_dist = 5;
+  return cs;
+}
+
+// one scene object, laid out like the std430 NHittable of the compute shaders
+// so a vector of them can be uploaded to the scene buffer as is
 struct NHittable {
-  int hittable_type;
-  vec4 sphere_center;
-  float sphere_radius;
-  int material_type; // 0: lambert, 1: metal, 2: dielectric;
-  vec4 lambert_albedo;
+  vec4 sphere_center;  // xyz: sphere center
+  vec4 lambert_albedo; // solid color, odd color of checkered texture
+  vec4 checker_even;   // even color of checkered texture
   vec4 metal_albedo;
+  int hittable_type;   // 0: sphere
+  int material_type;   // 0: lambert, 1: metal, 2: dielectric;
+  int texture_type;    // 0: solid, 1: checkered, 2: image, 3: noise
+  float sphere_radius;
   float metal_roughness;
   float dielectric_ref_idx;
+  float noise_scale;
+  float pad;
 };
+static_assert(sizeof(NHittable) == 96, "NHittable must match std430 layout");
+
 NHittable makeNHittable(int hittable_type, vec3 sphere_center,
                         float sphere_radius, int material_type,
                         vec3 lambert_albedo, vec3 metal_albedo,
@@ -152,10 +187,43 @@ NHittable makeNHittable(int hittable_type, vec3 sphere_center,
   nhit.sphere_center = vec4(sphere_center, 0);
   nhit.sphere_radius = sphere_radius;
   nhit.material_type = material_type;
+  nhit.texture_type = 0;
   nhit.lambert_albedo = vec4(lambert_albedo, 0);
+  nhit.checker_even = vec4(lambert_albedo, 0);
   nhit.metal_albedo = vec4(metal_albedo, 0);
   nhit.metal_roughness = metal_fuzz;
   nhit.dielectric_ref_idx = dielectric_ref_idx;
+  nhit.noise_scale = 1;
+  nhit.pad = 0;
+  return nhit;
+}
+NHittable makeLambertSphere(vec3 center, float radius, vec3 albedo) {
+  return makeNHittable(0, center, radius, 0, albedo, vec3(0), 0, 0);
+}
+NHittable makeMetalSphere(vec3 center, float radius, vec3 albedo,
+                          float fuzz) {
+  return makeNHittable(0, center, radius, 1, vec3(0), albedo, fuzz, 0);
+}
+NHittable makeDielectricSphere(vec3 center, float radius, float ref_idx) {
+  return makeNHittable(0, center, radius, 2, vec3(0), vec3(0), 0, ref_idx);
+}
+NHittable makeCheckeredSphere(vec3 center, float radius, vec3 odd,
+                              vec3 even) {
+  NHittable nhit = makeLambertSphere(center, radius, odd);
+  nhit.texture_type = 1;
+  nhit.checker_even = vec4(even, 0);
+  return nhit;
+}
+NHittable makeImageSphere(vec3 center, float radius) {
+  // albedo comes from the input image bound to the kernel
+  NHittable nhit = makeLambertSphere(center, radius, vec3(0));
+  nhit.texture_type = 2;
+  return nhit;
+}
+NHittable makeNoiseSphere(vec3 center, float radius, float scale) {
+  NHittable nhit = makeLambertSphere(center, radius, vec3(0.5));
+  nhit.texture_type = 3;
+  nhit.noise_scale = scale;
   return nhit;
 }
 
@@ -0,0 +1,8 @@
+// wavefront integrator on the weekend scene
+// license: see LICENSE
+#include "wavefront.hpp"
+
+int main() {
+  CAMERA = weekendCamera();
+  return launchWavefront("Compute Shader Wavefront", randomScene());
+}
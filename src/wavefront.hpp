@@ -0,0 +1,288 @@
+#ifndef WAVEFRONT_HPP
+#define WAVEFRONT_HPP
+// wavefront integrator: path state lives in storage buffers and every bounce
+// runs as separate extend and shade passes over a queue of live paths only,
+// instead of the per pixel ray_color loop of the megakernels
+// license: see LICENSE
+#include "window.hpp"
+
+// path state, laid out like the std430 Path of shaders/lib/wavefront.glsl
+struct WavefrontPath {
+  vec4 origin;
+  vec4 direction;
+  vec4 throughput;
+  vec4 radiance;
+  vec4 hit_point;
+  vec4 hit_normal;
+  int obj_index;
+  int depth;
+  GLuint sample_index;
+  GLuint sample_seed;
+};
+static_assert(sizeof(WavefrontPath) == 112,
+              "WavefrontPath must match std430 layout");
+
+// invocations per work group of the 1d path passes
+unsigned int WAVE_SIZE = 64;
+// bounces of a path, same as mdepth of the megakernels
+int WAVEFRONT_DEPTH = 50;
+// bounces between copies of the live path count to the host, the bounce
+// loop ends once a copy shows an empty queue. 0 runs every bounce.
+int WAVEFRONT_CHECK = 4;
+// copies in flight, the host only reads the ones the gpu is done with
+const int WAVEFRONT_RING = 4;
+
+struct WavefrontBuffers {
+  GLuint paths;     // binding 2
+  GLuint queues[2]; // bindings 3 and 4, swapped every bounce
+  GLuint state;     // binding 5, also the indirect dispatch buffer
+  GLuint path_count;
+  GLuint counts[WAVEFRONT_RING]; // in_count copies read by the host
+};
+
+WavefrontBuffers makeWavefront(unsigned int w, unsigned int h) {
+  // one path per pixel
+  WavefrontBuffers wf;
+  wf.path_count = w * h;
+  wf.paths = makeStorage(wf.path_count * sizeof(WavefrontPath), 2);
+  wf.queues[0] = makeStorage(wf.path_count * sizeof(GLint), 3);
+  wf.queues[1] = makeStorage(wf.path_count * sizeof(GLint), 4);
+  wf.state = makeStorage(sizeof(QueueState), 5);
+  glGenBuffers(WAVEFRONT_RING, wf.counts);
+  for (int i = 0; i < WAVEFRONT_RING; i++) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, wf.counts[i]);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return wf;
+}
+void deleteWavefront(WavefrontBuffers &wf) {
+  glDeleteBuffers(1, &wf.paths);
+  glDeleteBuffers(2, wf.queues);
+  glDeleteBuffers(1, &wf.state);
+  glDeleteBuffers(WAVEFRONT_RING, wf.counts);
+}
+
+void copyLiveCount(const WavefrontBuffers &wf, GLsync *fences, int slot) {
+  // queue a copy of the current queue length, a copy the gpu has not done
+  // yet when the ring comes round again is dropped
+  if (fences[slot] != 0) {
+    glDeleteSync(fences[slot]);
+  }
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_COPY_READ_BUFFER, wf.state);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, wf.counts[slot]);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                      offsetof(QueueState, in_count), 0, sizeof(GLuint));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+bool queueEmptied(const WavefrontBuffers &wf, GLsync *fences) {
+  // whether a finished copy shows no live path, never waits for the gpu.
+  // Queues only shrink, so the remaining bounces would launch nothing.
+  bool empty = false;
+  for (int i = 0; i < WAVEFRONT_RING; i++) {
+    if (fences[i] == 0) {
+      continue;
+    }
+    GLenum status = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+      continue;
+    }
+    glDeleteSync(fences[i]);
+    fences[i] = 0;
+    GLuint count = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, wf.counts[i]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(count), &count);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    empty = empty || count == 0;
+  }
+  return empty;
+}
+void resetWavefront(const WavefrontBuffers &wf) {
+  // every pixel starts with a live path in queue_in
+  QueueState state;
+  state.in_count = wf.path_count;
+  state.out_count = 0;
+  state.groups_x = (wf.path_count + WAVE_SIZE - 1) / WAVE_SIZE;
+  state.groups_y = 1;
+  state.groups_z = 1;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, wf.state);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(state), &state);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, wf.queues[0]);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, wf.queues[1]);
+  gerr();
+}
+
+Shader makeWaveShader(filesystem::path parent, const char *compute,
+                      const std::string &defines) {
+  // make 1d compute shader for the path passes
+  filesystem::path cpath = parent / compute;
+  Shader waveShader(cpath.c_str(), waveDefines(WAVE_SIZE) + defines);
+  gerr();
+  return waveShader;
+}
+
+struct WavefrontShaders {
+  Shader generate;
+  Shader extend;
+  Shader shade;
+  Shader prepare;
+  Shader accumulate;
+};
+WavefrontShaders makeWavefrontShaders(filesystem::path parent,
+                                      const std::vector<NHittable> &scene,
+                                      const SceneBuffers &buffers) {
+  return WavefrontShaders{
+      makeShader(parent, "wavefront_generate.comp"),
+      makeWaveShader(parent, "wavefront_extend.comp", bvhDefines(buffers)),
+      makeWaveShader(parent, "wavefront_shade.comp", sceneDefines(scene)),
+      makeWaveShader(parent, "queue_prepare.comp", ""),
+      makeShader(parent, "wavefront_accumulate.comp")};
+}
+
+void dispatchWavefront(WavefrontShaders &wfs, const WavefrontBuffers &wf,
+                       unsigned int frameIndex, unsigned int w,
+                       unsigned int h) {
+  // one sample per pixel: generate, then extend and shade for each bounce
+  // sized by the live path count on the gpu, then accumulate
+  const GLbitfield pass_barrier =
+      GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+  resetWavefront(wf);
+  wfs.generate.useProgram();
+  // camera and frame index come from the RenderParams block
+  wfs.generate.setIntUni("mdepth", WAVEFRONT_DEPTH);
+  dispatchTiles(wfs.generate, w, h);
+  glMemoryBarrier(pass_barrier);
+
+  wfs.shade.useProgram();
+  wfs.shade.setIntUni("mdepth", WAVEFRONT_DEPTH);
+  setRoulette(wfs.shade);
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, wf.state);
+  const GLintptr groups = offsetof(QueueState, groups_x);
+  GLsync fences[WAVEFRONT_RING] = {};
+  int next = 0;
+  for (int bounce = 0; bounce < WAVEFRONT_DEPTH; bounce++) {
+    wfs.extend.useProgram();
+    glDispatchComputeIndirect(groups);
+    glMemoryBarrier(pass_barrier);
+
+    wfs.shade.useProgram();
+    glDispatchComputeIndirect(groups);
+    glMemoryBarrier(pass_barrier);
+
+    // queue_out of this bounce is queue_in of the next one
+    wfs.shade.bindStorageBlock("QueueIn", wf.queues[(bounce + 1) % 2]);
+    wfs.shade.bindStorageBlock("QueueOut", wf.queues[bounce % 2]);
+    wfs.prepare.useProgram();
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(pass_barrier);
+
+    if (WAVEFRONT_CHECK > 0 && (bounce + 1) % WAVEFRONT_CHECK == 0) {
+      if (queueEmptied(wf, fences)) {
+        break;
+      }
+      copyLiveCount(wf, fences, next);
+      next = (next + 1) % WAVEFRONT_RING;
+    }
+  }
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+  for (int i = 0; i < WAVEFRONT_RING; i++) {
+    if (fences[i] != 0) {
+      glDeleteSync(fences[i]);
+    }
+  }
+
+  wfs.accumulate.useProgram();
+  setAccumulation(wfs.accumulate, frameIndex);
+  dispatchTiles(wfs.accumulate, w, h);
+  gerr();
+}
+
+int launchWavefront(const char *winTitle, const std::vector<NHittable> &scene) {
+  // same window loop as launch with the wavefront passes as ray kernel
+  GLFWwindow *window;
+  if (!openContext(winTitle, window)) {
+    return -1;
+  }
+  gerr();
+  glViewport(0, 0, WINWIDTH, WINHEIGHT);
+
+  GLuint vao, vbo;
+  setVertices(vao, vbo);
+
+  RenderTargets targets = makeRenderTargets(WINWIDTH, WINHEIGHT);
+
+  SceneBuffers scene_buffers = uploadScene(scene);
+
+  GLuint sobol_buffer = uploadSampler();
+  WavefrontBuffers wavefront = makeWavefront(targets.width, targets.height);
+
+  computeInfo();
+
+  Shader quadShader = makeShader(shaderDirPath, "compute.vert", "compute.frag");
+  WavefrontShaders wfs = makeWavefrontShaders(shaderDirPath, scene, scene_buffers);
+  RenderBlock render_params = makeRenderBlock();
+  bindRenderBlock(wfs.generate, render_params);
+  unsigned int frameIndex = 0;
+  CameraControls controls = makeControls();
+  ResolutionController resolution = makeResolution();
+  FrameTimer timer = makeFrameTimer(winTitle);
+  ReadbackRing recorder = makeReadback(targets.width, targets.height);
+
+  while (keepRendering(window, frameIndex)) {
+    if (followWindow(targets, resolution.scale)) {
+      // one path per pixel of the new size
+      deleteWavefront(wavefront);
+      wavefront = makeWavefront(targets.width, targets.height);
+      resizeReadback(recorder, targets.width, targets.height);
+      frameIndex = 0;
+      restartResolution(resolution);
+    }
+    rebuildScene(scene_buffers, timer);
+    beginPass(timer, RAY_PASS);
+    setRenderParams(render_params, frameIndex, 1);
+    dispatchWavefront(wfs, wavefront, frameIndex, targets.width,
+                      targets.height);
+    frameIndex++;
+
+    // writting is finished
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    endPass(timer, RAY_PASS);
+
+    recordFrame(recorder, targets.output);
+
+    if (!HEADLESS) {
+      beginPass(timer, DRAW_PASS);
+      regularDrawing(vao, targets.output, quadShader);
+      endPass(timer, DRAW_PASS);
+
+      if (manageWindow(window, controls)) {
+        // the paths have no preview, only the accumulation restarts
+        frameIndex = 0;
+        restartResolution(resolution);
+      }
+      if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+        glfwSetWindowShouldClose(window, 1);
+      }
+      swapBuffers(timer, window);
+    }
+    endFrame(timer, window);
+    updateResolution(resolution, timer, true);
+  }
+  deleteReadback(recorder);
+  if (HEADLESS) {
+    writePPM(targets.output, targets.width, targets.height, HEADLESS_OUTPUT);
+  }
+  deleteFrameTimer(timer);
+  deleteRenderBlock(render_params);
+  deleteRenderTargets(targets);
+  deleteWavefront(wavefront);
+  deleteScene(scene_buffers);
+  glDeleteBuffers(1, &sobol_buffer);
+  clear(vao, vbo);
+  return 0;
+}
+#endif
@@ -2,4 +2,11 @@
 // license: see LICENSE
 #include "window.hpp"
 
-int main() { return launch("Compute Shader Weekend", "weekend.comp"); }
+int main() {
+  // most of the cover converges early, only sample what is left
+  ADAPTIVE = true;
+  CAMERA = weekendCamera();
+  // render below the window size when a frame gets too slow
+  DYNAMIC_RESOLUTION = true;
+  return launch("Compute Shader Weekend", "weekend.comp", randomScene());
+}
@@ -7,6 +7,18 @@
 #include <GLFW/glfw3.h>
 #include <custom/shader.hpp>
 //
+#include "bvh.hpp"
+#include "bvh4.hpp"
+#include "camera.hpp"
+#include "controls.hpp"
+#include "headless.hpp"
+#include "lbvh.hpp"
+#include "readback.hpp"
+#include "resolution.hpp"
+#include "sampler.hpp"
+#include "scene.hpp"
+#include "timing.hpp"
+//
 #define STB_IMAGE_IMPLEMENTATION
 #include <custom/stb_image.h>
 //
@@ -140,9 +152,53 @@ unsigned int VIEWPORTX = 0;
 unsigned int VIEWPORTY = 0;
 float VIEWPORTF = 1000.0f;
 float VIEWPORTN = 1.0f;
+// framebuffer size, the render targets follow it when the window resizes
 unsigned int WINWIDTH = 384;
 unsigned int WINHEIGHT = 216;
 
+// compute tile size, one work group renders one tile of pixels
+unsigned int TILE_WIDTH = 8;
+unsigned int TILE_HEIGHT = 8;
+
+// progressive accumulation: every dispatch adds FRAME_SAMPLES samples per
+// pixel to a running sum instead of redrawing the kernel's full psample count
+bool ACCUMULATE = true;
+int FRAME_SAMPLES = 1;
+
+// bounces of a path for kernels reading the RenderParams block, 0 keeps the
+// MAX_DEPTH of the kernel
+int RENDER_DEPTH = 0;
+
+// progressive refinement: after the camera moved, kernels reading the
+// RenderParams block first trace one pixel per PREVIEW_STEP x PREVIEW_STEP
+// block with one sample, halve the block every frame and restart the
+// accumulation once they reach full resolution
+int PREVIEW_STEP = 4;
+
+// adaptive sampling: tiles whose pixels all reach the relative error
+// threshold retire, later frames only dispatch the remaining tiles. Needs
+// ACCUMULATE.
+bool ADAPTIVE = false;
+float ADAPTIVE_THRESHOLD = 0.02f;
+int ADAPTIVE_MIN_SAMPLES = 16;
+
+// russian roulette: after ROULETTE_DEPTH bounces a path goes on with the
+// probability of its largest throughput channel and is scaled up by it to
+// stay unbiased, so dark paths end early
+int ROULETTE_DEPTH = 3;
+
+// edge avoiding a-trous denoiser between the ray kernel and the quad pass,
+// guided by the first hit albedo, normal and distance of the ray kernel.
+// Each pass doubles the tap spacing, DENOISE_SIGMA_COLOR is the color
+// distance the first pass still averages over.
+bool DENOISE = false;
+int DENOISE_PASSES = 5;
+float DENOISE_SIGMA_COLOR = 1.0f;
+
+// file of media/textures loaded into image unit 1, the in_image of the
+// image textured kernels. Empty loads nothing.
+std::string INPUT_TEXTURE = "";
+
 void initializeGLFWMajorMinor(unsigned int maj, unsigned int min) {
   // initialize glfw version with correct profiling etc
   // Major 4, minor 3
@@ -156,7 +212,52 @@ void initializeGLFWMajorMinor(unsigned int maj, unsigned int min) {
 void framebuffer_size_callback(GLFWwindow *window, int newWidth,
                                int newHeight) {
   glViewport(0, 0, newWidth, newHeight);
+  // a minimized window keeps the last size
+  if (newWidth > 0 && newHeight > 0) {
+    WINWIDTH = newWidth;
+    WINHEIGHT = newHeight;
+  }
+}
+bool openContext(const char *winTitle, GLFWwindow *&window) {
+  // gl 4.3 context of a render loop. Headless runs take a surfaceless egl
+  // context and leave window NULL, or fall back to an invisible window.
+  headlessFromEnv();
+  recordFromEnv();
+  window = NULL;
+  if (HEADLESS && makeSurfacelessContext(4, 3)) {
+    return true;
+  }
+  initializeGLFWMajorMinor(4, 3);
+  if (HEADLESS) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
+  window = glfwCreateWindow(WINWIDTH, WINHEIGHT, winTitle, NULL, NULL);
+  if (window == NULL) {
+    std::cout << "Failed creating window" << std::endl;
+    return false;
+  }
+  glfwMakeContextCurrent(window);
+  // window resize
+  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  if (gladLoadGLLoader((GLADloadproc)(glfwGetProcAddress)) == 0) {
+    std::cout << "Failed to start glad" << std::endl;
+    glfwTerminate();
+    return false;
+  }
+  // the framebuffer is larger than the window on high dpi screens
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+  framebuffer_size_callback(window, fbWidth, fbHeight);
+  return true;
+}
+bool keepRendering(GLFWwindow *window, unsigned int frameIndex) {
+  // headless runs stop after a fixed number of frames
+  if (HEADLESS) {
+    return frameIndex < HEADLESS_FRAMES;
+  }
+  return glfwWindowShouldClose(window) == 0;
 }
+
 int setWindow(unsigned int w, unsigned int h) {
   // set window related
   // context initialized
@@ -188,7 +289,8 @@ void setVertices(GLuint &vao, GLuint &vbo) {
 }
 
 void setTexture(GLuint texture_output, unsigned int w, unsigned int h) {
-  // set texture related
+  // set texture related, the storage is immutable so a new size needs a new
+  // texture
   int texture_width = w;
   int texture_height = h;
   glActiveTexture(GL_TEXTURE0);
@@ -197,8 +299,7 @@ void setTexture(GLuint texture_output, unsigned int w, unsigned int h) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, texture_width, texture_height, 0,
-               GL_RGBA, GL_FLOAT, NULL);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, texture_width, texture_height);
   glBindImageTexture(0, texture_output, 0, GL_FALSE, 0, GL_WRITE_ONLY,
                      GL_RGBA32F);
   glBindTexture(GL_TEXTURE_2D, 0); // unbind
@@ -206,6 +307,55 @@ void setTexture(GLuint texture_output, unsigned int w, unsigned int h) {
   // end texture handling
   gerr();
 }
+void setImageTexture(GLuint texture, unsigned int w, unsigned int h,
+                     GLuint unit, GLenum access) {
+  // float image for compute shaders only, it is never sampled. The storage
+  // is immutable like the output's.
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, w, h);
+  glBindImageTexture(unit, texture, 0, GL_FALSE, 0, access, GL_RGBA32F);
+  glBindTexture(GL_TEXTURE_2D, 0); // unbind
+  gerr();
+}
+void setAccumTexture(GLuint texture_accum, unsigned int w, unsigned int h) {
+  // running sample sum: rgb is the radiance sum, alpha the sample count
+  setImageTexture(texture_accum, w, h, 2, GL_READ_WRITE);
+}
+
+struct RenderTargets {
+  GLuint output;      // image unit 0, drawn by the quad pass
+  GLuint accum;       // image unit 2
+  unsigned int width; // render resolution, below the window's when scaled
+  unsigned int height;
+};
+RenderTargets makeRenderTargets(unsigned int w, unsigned int h) {
+  RenderTargets rt{0, 0, w, h};
+  glGenTextures(1, &rt.output);
+  setTexture(rt.output, w, h);
+  glGenTextures(1, &rt.accum);
+  setAccumTexture(rt.accum, w, h);
+  return rt;
+}
+void deleteRenderTargets(RenderTargets &rt) {
+  glDeleteTextures(1, &rt.output);
+  glDeleteTextures(1, &rt.accum);
+}
+bool followWindow(RenderTargets &rt, float scale) {
+  // reallocate the targets when the window or the render scale changed,
+  // true when the accumulation has to restart
+  unsigned int w = scaledSize(WINWIDTH, scale);
+  unsigned int h = scaledSize(WINHEIGHT, scale);
+  if (w == rt.width && h == rt.height) {
+    return false;
+  }
+  deleteRenderTargets(rt);
+  rt = makeRenderTargets(w, h);
+  return true;
+}
 void setTexture(GLuint texture_input, const char *fname) {
   // set texture related
 
@@ -220,21 +370,40 @@ void setTexture(GLuint texture_input, const char *fname) {
     } else if (nbChannels == 4) {
       format = GL_RGBA;
     }
-    glActiveTexture(GL_TEXTURE1);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    gerr();
     glBindTexture(GL_TEXTURE_2D, texture_input);
+    gerr();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGB,
-                 GL_FLOAT, data);
-    glBindImageTexture(1, texture_input, 0, GL_FALSE, 0, GL_READ_ONLY,
+    gerr();
+    glTexImage2D(GL_TEXTURE_2D, // target
+                 0,             // level, 0 means base level
+                 GL_RGBA32F,    // internal format of image specifies color
+                 // components
+                 width, height, // what it says
+                 0,             // border, should be 0 at all times
+                 format,        // format of pixel data: GL_RGBA, GL_RGB, or
+                 // GL_RED
+                 GL_UNSIGNED_BYTE, // data type of pixel data
+                 data);
+    gerr();
+    glBindImageTexture(1,             // unit
+                       texture_input, // texture id
+                       0,             // level
+                       GL_FALSE,      // is layered
+                       0,             // layer no
+                       GL_READ_ONLY,  // access type
                        GL_RGBA32F);
 
     // end texture handling
     gerr();
+    glBindTexture(GL_TEXTURE_2D, 0); // unbind
   } else {
     std::cout << "Failed to load texture" << std::endl;
+    std::cout << "path: " << fname << std::endl;
   }
   stbi_image_free(data);
 }
@@ -259,8 +428,8 @@ void computeInfo() {
   std::cout << "total work group size x: " << work_group_size[0] << std::endl;
   std::cout << "total work group size y: " << work_group_size[1] << std::endl;
   std::cout << "total work group size z: " << work_group_size[2] << std::endl;
-  // global work group size is 512 * 512 == texture width * texture height
-  // local work group size is 1 since 1 pixel at a time
+  // global work group count is image size divided by the tile size
+  // local work group size is the tile size, TILE_WIDTH * TILE_HEIGHT
 
   // work group invocation
   GLint work_group_inv;
@@ -279,13 +448,366 @@ Shader makeShader(filesystem::path parent, const char *vertex,
   gerr();
   return quadShader;
 }
-Shader makeShader(filesystem::path parent, const char *compute) {
-  // make compute shader
+std::string tileDefines(unsigned int tw, unsigned int th) {
+  // tile size defines for compute shaders
+  std::ostringstream s;
+  s << "#define TILE_W " << tw << "\n";
+  s << "#define TILE_H " << th << "\n";
+  return s.str();
+}
+std::string waveDefines(unsigned int wave) {
+  // work group size define of the 1d queue passes
+  std::ostringstream s;
+  s << "#define WAVE_SIZE " << wave << "\n";
+  return s.str();
+}
+Shader makeComputeShader(filesystem::path parent, const char *compute,
+                         const std::string &defines) {
+  // make tiled compute shader with extra defines
   filesystem::path cpath = parent / compute;
-  Shader rayShader(cpath.c_str());
+  Shader rayShader(cpath.c_str(),
+                   tileDefines(TILE_WIDTH, TILE_HEIGHT) + defines);
   gerr();
   return rayShader;
 }
+Shader makeShader(filesystem::path parent, const char *compute) {
+  // make compute shader
+  return makeComputeShader(parent, compute, "");
+}
+
+void dispatchTiles(const Shader &shader, unsigned int w, unsigned int h) {
+  // launch enough tiles to cover w x h pixels, shaders discard the overhang
+  GLint tile[3];
+  glGetProgramiv(shader.programId, GL_COMPUTE_WORK_GROUP_SIZE, tile);
+  GLuint groupx = (w + tile[0] - 1) / tile[0];
+  GLuint groupy = (h + tile[1] - 1) / tile[1];
+  glDispatchCompute(groupx, groupy, 1);
+  gerr();
+}
+
+// queue counters and the indirect dispatch size of the next pass, laid out
+// like the std430 QueueState of shaders/lib/queue.glsl
+struct QueueState {
+  GLuint in_count;
+  GLuint out_count;
+  GLuint groups_x;
+  GLuint groups_y;
+  GLuint groups_z;
+};
+
+GLuint makeStorage(std::size_t size, GLuint binding) {
+  // device side storage buffer, contents are written by the kernels
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_COPY);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  gerr();
+  return buffer;
+}
+
+struct SceneBuffers {
+  GLuint objects; // NHittable array, storage buffer binding 0
+  GLuint nodes;   // flattened bvh, storage buffer binding 1
+  int object_count;
+  int node_count;
+  bool gpu_bvh; // the lbvh kernels build the nodes
+  GpuBvh builder;
+  int wide_stack; // stack of the four wide walk, 0 for the binary bvh
+};
+
+GLuint uploadStorage(const void *data, std::size_t size, GLuint binding) {
+  // static shader storage buffer at the given binding
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  gerr();
+  return buffer;
+}
+
+SceneBuffers uploadScene(const std::vector<NHittable> &scene) {
+  // build the bvh once and upload it with the reordered scene objects, the
+  // kernels read both instead of building the scene per invocation. With
+  // GPU_BVH the objects go up as they are and the lbvh kernels build it.
+  SceneBuffers buffers;
+  buffers.gpu_bvh = GPU_BVH && !scene.empty() && supportsGpuBvh();
+  buffers.wide_stack = 0;
+  if (buffers.gpu_bvh) {
+    buffers.object_count = static_cast<int>(scene.size());
+    buffers.node_count = 2 * buffers.object_count - 1;
+    buffers.objects =
+        uploadStorage(scene.data(), scene.size() * sizeof(NHittable), 0);
+    buffers.nodes = makeStorage(buffers.node_count * sizeof(BvhNode), 1);
+    buffers.builder = makeGpuBvh(shaderDirPath, buffers.object_count);
+    TimePoint start = timeNow();
+    buildGpuBvh(buffers.builder);
+    glFinish();
+    std::cout << "bvh gpu build: " << elapsedMs(start) << " ms" << std::endl;
+  } else {
+    Bvh bvh = buildBvh(scene);
+    buffers.object_count = static_cast<int>(bvh.objects.size());
+    buffers.node_count = static_cast<int>(bvh.nodes.size());
+    buffers.objects = uploadStorage(
+        bvh.objects.data(), bvh.objects.size() * sizeof(NHittable), 0);
+    if (BVH_WIDE) {
+      Bvh4 wide = collapseBvh(bvh);
+      buffers.node_count = wide.node_count;
+      buffers.wide_stack = wide.stack_size;
+      buffers.nodes = uploadStorage(
+          wide.words.data(), wide.words.size() * sizeof(uint32_t), 1);
+    } else {
+      buffers.nodes = uploadStorage(bvh.nodes.data(),
+                                    bvh.nodes.size() * sizeof(BvhNode), 1);
+    }
+  }
+  gerr();
+  std::cout << "scene objects: " << buffers.object_count
+            << " bvh nodes: " << buffers.node_count << std::endl;
+  return buffers;
+}
+std::string bvhDefines(const SceneBuffers &buffers) {
+  // layout of the nodes for the walk of lib/hittable.glsl
+  if (buffers.wide_stack == 0) {
+    return "";
+  }
+  std::ostringstream s;
+  s << "#define BVH4\n";
+  s << "#define BVH4_BITS " << BVH4_BITS << "\n";
+  s << "#define BVH4_STACK " << buffers.wide_stack << "\n";
+  return s.str();
+}
+void rebuildScene(SceneBuffers &buffers, FrameTimer &timer) {
+  // build the gpu bvh again before the ray kernels of a frame
+  if (!buffers.gpu_bvh || !GPU_BVH_EVERY_FRAME) {
+    return;
+  }
+  beginPass(timer, BVH_PASS);
+  buildGpuBvh(buffers.builder);
+  endPass(timer, BVH_PASS);
+  gerr();
+}
+void deleteScene(SceneBuffers &buffers) {
+  glDeleteBuffers(1, &buffers.objects);
+  glDeleteBuffers(1, &buffers.nodes);
+  if (buffers.gpu_bvh) {
+    deleteGpuBvh(buffers.builder);
+  }
+}
+
+GLuint uploadSampler() {
+  // sobol direction numbers of the sampler at storage buffer binding 6
+  std::vector<GLuint> directions = sobolDirections();
+  return uploadStorage(directions.data(), directions.size() * sizeof(GLuint),
+                       6);
+}
+
+void setAccumulation(const Shader &shader, unsigned int frameIndex) {
+  // accumulation uniforms, kernels without a sample loop do not declare them
+  GLint findex = shader.uniformLocation("frame_index");
+  GLint fsamples = shader.uniformLocation("frame_samples");
+  if (findex != -1) {
+    glUniform1i(findex, ACCUMULATE ? frameIndex : 0);
+  }
+  if (fsamples != -1) {
+    glUniform1i(fsamples, ACCUMULATE ? FRAME_SAMPLES : 0);
+  }
+  gerr();
+}
+
+void setRenderParams(RenderBlock &rb, unsigned int frameIndex,
+                     int previewStep) {
+  // camera and frame values of the RenderParams block, the buffer is only
+  // written when one of them changed since the last frame
+  RenderParams params = cameraParams(CAMERA, WINWIDTH, WINHEIGHT);
+  params.max_depth = RENDER_DEPTH;
+  params.frame_samples = ACCUMULATE ? FRAME_SAMPLES : 0;
+  params.frame_index = ACCUMULATE ? frameIndex : 0;
+  params.preview_step = previewStep;
+  if (previewStep > 1) {
+    params.frame_samples = 1;
+    params.frame_index = 0;
+  }
+  updateRenderBlock(rb, params);
+  gerr();
+}
+
+bool supportsPreview(const Shader &shader) {
+  // kernels reading the RenderParams block can trace a preview
+  return shader.hasUniformBlock("RenderParams");
+}
+void dispatchPreview(const Shader &shader, unsigned int w, unsigned int h,
+                     int previewStep) {
+  // one invocation per block, it fills the whole block of the output
+  dispatchTiles(shader, (w + previewStep - 1) / previewStep,
+                (h + previewStep - 1) / previewStep);
+}
+
+void setRoulette(const Shader &shader) {
+  // bounces before russian roulette, kernels without a bounce loop skip it
+  GLint rdepth = shader.uniformLocation("rr_depth");
+  if (rdepth != -1) {
+    glUniform1i(rdepth, ROULETTE_DEPTH);
+  }
+  gerr();
+}
+
+struct AdaptiveTiles {
+  GLuint tiles[2];       // active and next tile lists, bindings 3 and 4
+  GLuint state;          // binding 5, also the indirect dispatch buffer
+  GLuint texture_moments; // image unit 3, sum of the squared samples
+  GLuint tile_count;
+  int current; // tiles[current] is the active list
+  Shader tileShader;
+  Shader prepareShader;
+};
+
+bool supportsAdaptive(const Shader &shader) {
+  // kernels built with ADAPTIVE read their work groups from the tile list
+  return shader.hasStorageBlock("TileList");
+}
+void allocAdaptive(AdaptiveTiles &at, unsigned int w, unsigned int h) {
+  // tile lists hold every tile of the image at most
+  GLuint tiles_x = (w + TILE_WIDTH - 1) / TILE_WIDTH;
+  GLuint tiles_y = (h + TILE_HEIGHT - 1) / TILE_HEIGHT;
+  at.tile_count = tiles_x * tiles_y;
+  at.current = 0;
+  at.tiles[0] = makeStorage(at.tile_count * sizeof(GLint), 3);
+  at.tiles[1] = makeStorage(at.tile_count * sizeof(GLint), 4);
+  at.state = makeStorage(sizeof(QueueState), 5);
+  glGenTextures(1, &at.texture_moments);
+  setImageTexture(at.texture_moments, w, h, 3, GL_READ_WRITE);
+}
+AdaptiveTiles makeAdaptive(unsigned int w, unsigned int h) {
+  AdaptiveTiles at{{0, 0},
+                   0,
+                   0,
+                   0,
+                   0,
+                   makeShader(shaderDirPath, "adaptive_tiles.comp"),
+                   Shader((shaderDirPath / "queue_prepare.comp").c_str(),
+                          waveDefines(1))};
+  allocAdaptive(at, w, h);
+  return at;
+}
+void deleteAdaptive(AdaptiveTiles &at) {
+  glDeleteBuffers(2, at.tiles);
+  glDeleteBuffers(1, &at.state);
+  glDeleteTextures(1, &at.texture_moments);
+}
+void resizeAdaptive(AdaptiveTiles &at, unsigned int w, unsigned int h) {
+  // new tile lists and moments, the next frame resets them
+  deleteAdaptive(at);
+  allocAdaptive(at, w, h);
+}
+void resetAdaptive(AdaptiveTiles &at) {
+  // every tile is active again, called when the accumulation restarts
+  std::vector<GLint> tiles(at.tile_count);
+  for (GLuint i = 0; i < at.tile_count; i++) {
+    tiles[i] = i;
+  }
+  at.current = 0;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, at.tiles[0]);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, tiles.size() * sizeof(GLint),
+                  tiles.data());
+  QueueState state{at.tile_count, 0, at.tile_count, 1, 1};
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, at.state);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(state), &state);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, at.tiles[0]);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, at.tiles[1]);
+  gerr();
+}
+void dispatchAdaptive(Shader &rayShader, AdaptiveTiles &at,
+                      unsigned int frameIndex) {
+  // sample the active tiles, then keep the ones that have not converged
+  // for the next frame, both passes size themselves from the gpu side count
+  const GLbitfield pass_barrier = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                                  GL_SHADER_STORAGE_BARRIER_BIT |
+                                  GL_COMMAND_BARRIER_BIT;
+  if (frameIndex == 0) {
+    resetAdaptive(at);
+  }
+  const GLintptr groups = offsetof(QueueState, groups_x);
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, at.state);
+  // the passes below switch programs, the samples are the ray kernel's
+  rayShader.useProgram();
+  glDispatchComputeIndirect(groups);
+  glMemoryBarrier(pass_barrier);
+
+  at.tileShader.useProgram();
+  at.tileShader.setFloatUni("adaptive_threshold", ADAPTIVE_THRESHOLD);
+  at.tileShader.setIntUni("adaptive_min_samples", ADAPTIVE_MIN_SAMPLES);
+  glDispatchComputeIndirect(groups);
+  glMemoryBarrier(pass_barrier);
+  glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+  // the next list becomes the active one
+  at.current = 1 - at.current;
+  at.tileShader.bindStorageBlock("TileList", at.tiles[at.current]);
+  at.tileShader.bindStorageBlock("NextTileList", at.tiles[1 - at.current]);
+  at.prepareShader.useProgram();
+  glDispatchCompute(1, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+  gerr();
+}
+
+struct Denoiser {
+  GLuint texture_albedo; // image unit 4
+  GLuint texture_normal; // image unit 5, w is the hit distance
+  GLuint textures[2];    // ping pong images of the passes, units 6 and 7
+  Shader atrousShader;
+};
+
+bool supportsDenoise(const Shader &shader) {
+  // kernels built with DENOISE write the feature images
+  return shader.hasUniform("img_albedo");
+}
+void allocDenoiser(Denoiser &dn, unsigned int w, unsigned int h) {
+  glGenTextures(1, &dn.texture_albedo);
+  setImageTexture(dn.texture_albedo, w, h, 4, GL_READ_WRITE);
+  glGenTextures(1, &dn.texture_normal);
+  setImageTexture(dn.texture_normal, w, h, 5, GL_READ_WRITE);
+  glGenTextures(2, dn.textures);
+  setImageTexture(dn.textures[0], w, h, 6, GL_READ_WRITE);
+  setImageTexture(dn.textures[1], w, h, 7, GL_READ_WRITE);
+}
+Denoiser makeDenoiser(unsigned int w, unsigned int h) {
+  Denoiser dn{0, 0, {0, 0}, makeShader(shaderDirPath, "atrous.comp")};
+  allocDenoiser(dn, w, h);
+  return dn;
+}
+void deleteDenoiser(Denoiser &dn) {
+  glDeleteTextures(1, &dn.texture_albedo);
+  glDeleteTextures(1, &dn.texture_normal);
+  glDeleteTextures(2, dn.textures);
+}
+void resizeDenoiser(Denoiser &dn, unsigned int w, unsigned int h) {
+  // features are written again when the accumulation restarts
+  deleteDenoiser(dn);
+  allocDenoiser(dn, w, h);
+}
+void dispatchDenoise(Denoiser &dn, unsigned int w, unsigned int h) {
+  // filter the accumulated image into the output image, the first pass
+  // reads the accumulation and the last one writes img_output
+  dn.atrousShader.useProgram();
+  dn.atrousShader.setIntUni("atrous_passes", DENOISE_PASSES);
+  dn.atrousShader.setFloatUni("sigma_color", DENOISE_SIGMA_COLOR);
+  for (int pass = 0; pass < DENOISE_PASSES; pass++) {
+    // pass n reads what pass n - 1 wrote
+    glBindImageTexture(6, dn.textures[(pass + 1) % 2], 0, GL_FALSE, 0,
+                       GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(7, dn.textures[pass % 2], 0, GL_FALSE, 0,
+                       GL_WRITE_ONLY, GL_RGBA32F);
+    dn.atrousShader.setIntUni("atrous_pass", pass);
+    dispatchTiles(dn.atrousShader, w, h);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+  }
+  gerr();
+}
 
 void regularDrawing(GLuint vao, GLuint texture_output, Shader quadShader) {
   // regular draw commands for rendering quad
@@ -304,33 +826,23 @@ void regularDrawing(GLuint vao, GLuint texture_output, Shader quadShader) {
   glfwPollEvents();
 }
 
-void manageWindow(GLFWwindow *window) {}
+bool manageWindow(GLFWwindow *window, CameraControls &controls) {
+  // camera input of the frame, true when the accumulation has to restart
+  return moveCamera(controls, window, CAMERA);
+}
 
 void clear(GLuint vao, GLuint vbo) {
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
+  destroySurfacelessContext();
   glfwTerminate();
 }
 
-int launch(const char *winTitle, const char *shaderName) {
+int launch(const char *winTitle, const char *shaderName,
+           const std::vector<NHittable> &scene) {
   // set window
-  initializeGLFWMajorMinor(4, 3);
-
   GLFWwindow *window;
-  window = glfwCreateWindow(WINWIDTH, WINHEIGHT, winTitle, NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed creating window" << std::endl;
-    return -1;
-  }
-  glfwMakeContextCurrent(window);
-  // window resize
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-  glfwMakeContextCurrent(window);
-  // window resize
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-  if (gladLoadGLLoader((GLADloadproc)(glfwGetProcAddress)) == 0) {
-    std::cout << "Failed to start glad" << std::endl;
-    glfwTerminate();
+  if (!openContext(winTitle, window)) {
     return -1;
   }
   gerr();
@@ -345,9 +857,19 @@ int launch(const char *winTitle, const char *shaderName) {
   // http://antongerdelan.net/opengl/compute.html
   //
   // texture handling bit
-  GLuint texture_output;
-  glGenTextures(1, &texture_output);
-  setTexture(texture_output, WINWIDTH, WINHEIGHT);
+  RenderTargets targets = makeRenderTargets(WINWIDTH, WINHEIGHT);
+
+  // load input texture, it stays bound to its image unit
+  GLuint texture_input = 0;
+  if (!INPUT_TEXTURE.empty()) {
+    glGenTextures(1, &texture_input);
+    filesystem::path texpath = textureDirPath / INPUT_TEXTURE;
+    setTexture(texture_input, texpath.c_str());
+  }
+
+  // scene is built once and shared by every invocation
+  SceneBuffers scene_buffers = uploadScene(scene);
+  GLuint sobol_buffer = uploadSampler();
 
   // compute shader related info
   computeInfo();
@@ -358,29 +880,118 @@ int launch(const char *winTitle, const char *shaderName) {
   // end quad shader
 
   // compute shader part
-  Shader rayShader = makeShader(shaderDirPath, shaderName);
-
-  while (glfwWindowShouldClose(window) == 0) {
+  std::string defines = sceneDefines(scene) + bvhDefines(scene_buffers);
+  if (ADAPTIVE) {
+    defines += "#define ADAPTIVE\n";
+  }
+  if (DENOISE) {
+    defines += "#define DENOISE\n";
+  }
+  Shader rayShader = makeComputeShader(shaderDirPath, shaderName, defines);
+  RenderBlock render_params = makeRenderBlock();
+  bindRenderBlock(rayShader, render_params);
+  bool adaptive = ADAPTIVE && ACCUMULATE && supportsAdaptive(rayShader);
+  AdaptiveTiles tiles;
+  if (adaptive) {
+    tiles = makeAdaptive(targets.width, targets.height);
+  }
+  bool preview = supportsPreview(rayShader);
+  bool denoise = DENOISE && supportsDenoise(rayShader);
+  Denoiser denoiser;
+  if (denoise) {
+    denoiser = makeDenoiser(targets.width, targets.height);
+  }
+  unsigned int frameIndex = 0;
+  int previewStep = 1; // block size of the next frame, 1 for full resolution
+  CameraControls controls = makeControls();
+  ResolutionController resolution = makeResolution();
+  FrameTimer timer = makeFrameTimer(winTitle);
+  ReadbackRing recorder = makeReadback(targets.width, targets.height);
+
+  while (keepRendering(window, frameIndex)) {
+    if (followWindow(targets, resolution.scale)) {
+      // everything sized by the render resolution starts over
+      if (adaptive) {
+        resizeAdaptive(tiles, targets.width, targets.height);
+      }
+      if (denoise) {
+        resizeDenoiser(denoiser, targets.width, targets.height);
+      }
+      resizeReadback(recorder, targets.width, targets.height);
+      frameIndex = 0;
+      restartResolution(resolution);
+    }
+    rebuildScene(scene_buffers, timer);
     // rendering call
     // launch shaders
+    beginPass(timer, RAY_PASS);
     rayShader.useProgram();
     gerr();
-    glDispatchCompute((GLuint)WINWIDTH, (GLuint)WINHEIGHT, 1);
-    gerr();
+    setAccumulation(rayShader, frameIndex);
+    setRenderParams(render_params, frameIndex, previewStep);
+    setRoulette(rayShader);
+    bool refined = previewStep == 1;
+    if (!refined) {
+      dispatchPreview(rayShader, targets.width, targets.height, previewStep);
+      previewStep /= 2;
+    } else if (adaptive) {
+      dispatchAdaptive(rayShader, tiles, frameIndex);
+      frameIndex++;
+    } else {
+      dispatchTiles(rayShader, targets.width, targets.height);
+      frameIndex++;
+    }
     // end launch shaders
 
     // writting is finished
     glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    endPass(timer, RAY_PASS);
+    if (denoise && refined) {
+      beginPass(timer, DENOISE_PASS);
+      dispatchDenoise(denoiser, targets.width, targets.height);
+      endPass(timer, DENOISE_PASS);
+    }
+
+    recordFrame(recorder, targets.output);
 
-    // start rendering quad
-    regularDrawing(vao, texture_output, quadShader);
+    // start rendering quad, it scales the output up to the window
+    if (!HEADLESS) {
+      beginPass(timer, DRAW_PASS);
+      regularDrawing(vao, targets.output, quadShader);
+      endPass(timer, DRAW_PASS);
 
-    manageWindow(window);
-    if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
-      glfwSetWindowShouldClose(window, 1);
+      if (manageWindow(window, controls)) {
+        // the accumulated samples belong to the old view
+        frameIndex = 0;
+        previewStep = preview ? PREVIEW_STEP : 1;
+        restartResolution(resolution);
+      }
+      if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+        glfwSetWindowShouldClose(window, 1);
+      }
+      swapBuffers(timer, window);
     }
-    glfwSwapBuffers(window);
+    endFrame(timer, window);
+    updateResolution(resolution, timer, refined);
+  }
+  deleteReadback(recorder);
+  if (HEADLESS) {
+    writePPM(targets.output, targets.width, targets.height, HEADLESS_OUTPUT);
+  }
+  deleteFrameTimer(timer);
+  if (adaptive) {
+    deleteAdaptive(tiles);
+  }
+  if (denoise) {
+    deleteDenoiser(denoiser);
+  }
+  deleteRenderBlock(render_params);
+  deleteRenderTargets(targets);
+  if (texture_input != 0) {
+    glDeleteTextures(1, &texture_input);
   }
+  deleteScene(scene_buffers);
+  glDeleteBuffers(1, &sobol_buffer);
   clear(vao, vbo);
   return 0;
 }